@@ -0,0 +1,185 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Generates synthetic captures and replays captures, reporting the decoding
+// throughput and latency percentiles.
+//
+//   xcdr2_replay generate <capture> [count] [profile]...
+//   xcdr2_replay replay <capture> [iterations]
+//
+// A profile is type:weight:median:spread, with a trailing :big for big
+// endian payloads. Replaying decodes every type as a synthetic message, so
+// captures of other messages need decoders of their own, see replay().
+
+#include "xcdr2_replay.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace once::cpputils;
+using namespace once::cpputils::xcdr2::benchmark;
+
+namespace {
+
+int
+usage()
+{
+  std::fprintf(stderr,
+               "usage: xcdr2_replay generate <capture> [count] "
+               "[type:weight:median:spread[:big]]...\n"
+               "       xcdr2_replay replay <capture> [iterations]\n");
+  return EXIT_FAILURE;
+}
+
+bool
+parse(std::string const& text, size_t& value)
+{
+  char* end = nullptr;
+  errno = 0;
+  const unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+  if (text.empty() || ('-' == text[0]) || ('\0' != *end) || (0 != errno)) {
+    return false;
+  }
+  value = static_cast<size_t>(parsed);
+  return true;
+}
+
+bool
+parse(std::string const& text, double& value)
+{
+  char* end = nullptr;
+  errno = 0;
+  value = std::strtod(text.c_str(), &end);
+  return !text.empty() && ('\0' == *end) && (0 == errno);
+}
+
+bool
+parse_profile(std::string const& spec, TypeProfile& profile)
+{
+  std::istringstream input{ spec };
+  std::string field;
+  std::vector<std::string> fields;
+  while (std::getline(input, field, ':')) {
+    fields.push_back(field);
+  }
+  if ((fields.size() < 4) || (fields.size() > 5)) {
+    return false;
+  }
+  size_t type{};
+  if (!parse(fields[0], type) || (UINT32_MAX < type) ||
+      !parse(fields[1], profile.weight) ||
+      !parse(fields[2], profile.median_size) ||
+      !parse(fields[3], profile.size_spread)) {
+    return false;
+  }
+  profile.type = static_cast<uint32_t>(type);
+  if (5 == fields.size()) {
+    if ("big" != fields[4]) {
+      return false;
+    }
+    profile.endian = Endian::big;
+  } else {
+    profile.endian = Endian::little;
+  }
+  return true;
+}
+
+int
+run_generate(int argc, char** argv)
+{
+  size_t count = 100000;
+  if ((3 < argc) && !parse(argv[3], count)) {
+    return usage();
+  }
+  std::vector<TypeProfile> profiles;
+  for (int i = 4; i < argc; ++i) {
+    TypeProfile profile{};
+    if (!parse_profile(argv[i], profile)) {
+      return usage();
+    }
+    profiles.push_back(profile);
+  }
+  if (profiles.empty()) {
+    profiles = { { 1, 0.70, 96, 0.3, Endian::little },
+                 { 2, 0.25, 1024, 0.5, Endian::little },
+                 { 3, 0.05, 64 * 1024, 0.8, Endian::little } };
+  }
+  CaptureGenerator generator{ std::move(profiles), 10000.0 };
+  if (!xcdr2::save_capture(argv[2], generator.generate(count))) {
+    std::fprintf(stderr, "cannot write %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int
+run_replay(int argc, char** argv)
+{
+  size_t iterations = 10;
+  if ((3 < argc) && !parse(argv[3], iterations)) {
+    return usage();
+  }
+  std::vector<xcdr2::CaptureRecord> records;
+  if (!xcdr2::load_capture(argv[2], records)) {
+    std::fprintf(stderr, "cannot read %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  std::unordered_map<uint32_t, Decoder> decoders;
+  for (auto&& record : records) {
+    if (0 == decoders.count(record.type)) {
+      decoders.emplace(record.type, decoder<SyntheticMessage>());
+    }
+  }
+  replay(records, decoders);
+  const ReplayReport report = replay(records, decoders, iterations);
+  std::printf("messages: %zu (%zu errors, %zu skipped)\n",
+              report.messages,
+              report.errors,
+              report.skipped);
+  std::printf("throughput: %.0f msg/s, %.1f MB/s\n",
+              report.messages_per_second(),
+              report.bytes_per_second() / 1e6);
+  std::printf("latency (ns): p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, "
+              "max %llu\n",
+              static_cast<unsigned long long>(report.p50),
+              static_cast<unsigned long long>(report.p90),
+              static_cast<unsigned long long>(report.p99),
+              static_cast<unsigned long long>(report.p999),
+              static_cast<unsigned long long>(report.max));
+  return (0 == report.errors) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 3) {
+    return usage();
+  }
+  const std::string command = argv[1];
+  if ("generate" == command) {
+    return run_generate(argc, argv);
+  }
+  if ("replay" == command) {
+    return run_replay(argc, argv);
+  }
+  return usage();
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__BENCHMARK__XCDR2_REPLAY_HPP_
+#define ONCE__CPPUTILS__BENCHMARK__XCDR2_REPLAY_HPP_
+
+#include <once/cpputils/stream/xcdr2_capture.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+namespace benchmark {
+
+// Stand-in for production messages, whose shape a generator reproduces
+// without their content.
+struct SyntheticMessage
+{
+  uint64_t id;
+  std::vector<int32_t> counters;
+  std::vector<double> values;
+  std::string text;
+  std::vector<std::string> labels;
+};
+
+template<Endian E, typename B>
+Stream<E, B>&
+operator<<(Stream<E, B>& stream, SyntheticMessage const& message)
+{
+  return stream << message.id << message.counters << message.values
+                << message.text << message.labels;
+}
+
+template<Endian E, typename B>
+Stream<E, B>&
+operator>>(Stream<E, B>& stream, SyntheticMessage& message)
+{
+  return stream >> message.id >> message.counters >> message.values >>
+         message.text >> message.labels;
+}
+
+// Shape of the messages of one type: how often they appear, and their
+// serialized size, which is log-normal around a median.
+struct TypeProfile
+{
+  uint32_t type;
+  double weight;
+  size_t median_size;
+  double size_spread;
+  Endian endian = Endian::native;
+};
+
+class CaptureGenerator
+{
+public:
+  CaptureGenerator(std::vector<TypeProfile> profiles,
+                   double messages_per_second,
+                   uint64_t seed = 0)
+    : profiles_{ std::move(profiles) }
+    , messages_per_second_{ messages_per_second }
+    , random_{ seed }
+  {
+  }
+
+  std::vector<CaptureRecord> generate(size_t count)
+  {
+    std::vector<double> weights;
+    for (auto&& profile : profiles_) {
+      weights.push_back(profile.weight);
+    }
+    std::discrete_distribution<size_t> pick{ weights.begin(), weights.end() };
+    std::exponential_distribution<double> gap{ messages_per_second_ };
+    std::vector<CaptureRecord> records;
+    records.reserve(count);
+    double seconds = 0;
+    for (size_t i = 0; i < count; ++i) {
+      TypeProfile const& profile = profiles_[pick(random_)];
+      std::lognormal_distribution<double> size{
+        std::log(static_cast<double>(std::max<size_t>(1, profile.median_size))),
+        profile.size_spread
+      };
+      seconds += gap(random_);
+      CaptureRecord record{ static_cast<uint64_t>(seconds * 1e9),
+                            profile.type,
+                            profile.endian,
+                            {} };
+      const SyntheticMessage message =
+        synthesize(i, static_cast<size_t>(size(random_)));
+      if (Endian::little == profile.endian) {
+        record.payload = encode<Endian::little>(message);
+      } else {
+        record.payload = encode<Endian::big>(message);
+      }
+      records.push_back(std::move(record));
+    }
+    return records;
+  }
+
+private:
+  template<Endian E>
+  static std::vector<uint8_t> encode(SyntheticMessage const& message)
+  {
+    VectorStreamEndian<E> stream{};
+    stream << message;
+    return stream.release();
+  }
+
+  // Splits a size budget between the members: mostly numbers, then text.
+  SyntheticMessage synthesize(uint64_t id, size_t size)
+  {
+    SyntheticMessage message{ id, {}, {}, {}, {} };
+    size_t budget = (size > 32) ? size - 32 : 0;
+    message.values.resize(budget / 2 / sizeof(double));
+    message.counters.resize(budget / 4 / sizeof(int32_t));
+    std::uniform_int_distribution<int32_t> counter{ 0, 1 << 20 };
+    std::uniform_real_distribution<double> value{ -1e3, 1e3 };
+    std::uniform_int_distribution<int> letter{ 'a', 'z' };
+    for (auto&& item : message.values) {
+      item = value(random_);
+    }
+    for (auto&& item : message.counters) {
+      item = counter(random_);
+    }
+    const size_t text_size = budget / 8;
+    for (size_t i = 0; i < text_size; ++i) {
+      message.text.push_back(static_cast<char>(letter(random_)));
+    }
+    for (size_t left = budget / 8; 16 <= left; left -= 16) {
+      message.labels.emplace_back(11, static_cast<char>(letter(random_)));
+    }
+    return message;
+  }
+
+  std::vector<TypeProfile> profiles_;
+  double messages_per_second_;
+  std::mt19937_64 random_;
+};
+
+struct ReplayReport
+{
+  size_t messages = 0;
+  size_t bytes = 0;
+  size_t errors = 0;
+  // Records of a type without a decoder, neither decoded nor timed.
+  size_t skipped = 0;
+  double seconds = 0;
+  // Per message decoding time, in nanoseconds.
+  uint64_t p50 = 0;
+  uint64_t p90 = 0;
+  uint64_t p99 = 0;
+  uint64_t p999 = 0;
+  uint64_t max = 0;
+
+  double messages_per_second() const { return messages / seconds; }
+  double bytes_per_second() const { return bytes / seconds; }
+};
+
+// Decodes a payload of the given endianness, returning whether it was valid.
+// The payload is lent for the call, and shall be left as it was found.
+using Decoder = std::function<bool(Endian, std::vector<uint8_t>&)>;
+
+// Decoder into a single object of type T, reused from one payload to the
+// next as an application would.
+template<typename T>
+Decoder
+decoder()
+{
+  return [message = T{}](Endian endian,
+                         std::vector<uint8_t>& payload) mutable {
+    bool ok;
+    if (Endian::little == endian) {
+      VectorStreamEndian<Endian::little> stream{ std::move(payload) };
+      stream >> message;
+      ok = StreamState::ok == stream.deser_state();
+      payload = stream.release();
+    } else {
+      VectorStreamEndian<Endian::big> stream{ std::move(payload) };
+      stream >> message;
+      ok = StreamState::ok == stream.deser_state();
+      payload = stream.release();
+    }
+    return ok;
+  };
+}
+
+// Decodes every record as fast as possible with the decoder of its type,
+// timing each decoding on its own. The timestamps are ignored.
+inline ReplayReport
+replay(std::vector<CaptureRecord>& records,
+       std::unordered_map<uint32_t, Decoder>& decoders,
+       size_t iterations = 1)
+{
+  using clock = std::chrono::steady_clock;
+  ReplayReport report{};
+  std::vector<uint64_t> latencies;
+  latencies.reserve(records.size() * iterations);
+  const auto start = clock::now();
+  for (size_t iteration = 0; iteration < iterations; ++iteration) {
+    for (auto& record : records) {
+      auto decoder = decoders.find(record.type);
+      if (decoders.end() == decoder) {
+        ++report.skipped;
+        continue;
+      }
+      const auto begin = clock::now();
+      const bool ok = decoder->second(record.endian, record.payload);
+      const auto end = clock::now();
+      latencies.push_back(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+          .count()));
+      report.errors += ok ? 0 : 1;
+      report.bytes += record.payload.size();
+      ++report.messages;
+    }
+  }
+  report.seconds =
+    std::chrono::duration<double>(clock::now() - start).count();
+  if (!latencies.empty()) {
+    auto percentile = [&latencies](double fraction) {
+      auto nth = latencies.begin() +
+                 static_cast<ptrdiff_t>(fraction * (latencies.size() - 1));
+      std::nth_element(latencies.begin(), nth, latencies.end());
+      return *nth;
+    };
+    report.p50 = percentile(0.5);
+    report.p90 = percentile(0.9);
+    report.p99 = percentile(0.99);
+    report.p999 = percentile(0.999);
+    report.max = *std::max_element(latencies.begin(), latencies.end());
+  }
+  return report;
+}
+
+} // namespace benchmark
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__BENCHMARK__XCDR2_REPLAY_HPP_
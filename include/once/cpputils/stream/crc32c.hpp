@@ -0,0 +1,145 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__CRC32C_HPP_
+#define ONCE__CPPUTILS__STREAM__CRC32C_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ONCE__CPPUTILS__CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace once {
+namespace cpputils {
+namespace crc32c {
+
+namespace detail {
+
+// Castagnoli polynomial, reflected.
+inline constexpr uint32_t polynomial = 0x82F63B78;
+
+using Table = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr Table
+make_table()
+{
+  Table table{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+    }
+    table[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; ++i) {
+    for (size_t slice = 1; slice < table.size(); ++slice) {
+      const uint32_t previous = table[slice - 1][i];
+      table[slice][i] = (previous >> 8) ^ table[0][previous & 0xFF];
+    }
+  }
+  return table;
+}
+
+inline constexpr Table table = make_table();
+
+// Slicing-by-8 over the raw (non inverted) register.
+inline uint32_t
+software(uint32_t crc, uint8_t const* data, size_t size)
+{
+  while ((0 < size) && (reinterpret_cast<uintptr_t>(data) & 7)) {
+    crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+    --size;
+  }
+  while (8 <= size) {
+    uint32_t low;
+    uint32_t high;
+    std::memcpy(&low, data, sizeof(low));
+    std::memcpy(&high, data + sizeof(low), sizeof(high));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    low = __builtin_bswap32(low);
+    high = __builtin_bswap32(high);
+#endif
+    low ^= crc;
+    crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+          table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+          table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+          table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+    data += 8;
+    size -= 8;
+  }
+  while (0 < size--) {
+    crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+  }
+  return crc;
+}
+
+#ifdef ONCE__CPPUTILS__CRC32C_SSE42
+__attribute__((target("sse4.2"))) inline uint32_t
+hardware(uint32_t crc, uint8_t const* data, size_t size)
+{
+  uint64_t crc64 = crc;
+  while (8 <= size) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += 8;
+    size -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (0 < size--) {
+    crc = _mm_crc32_u8(crc, *data++);
+  }
+  return crc;
+}
+
+inline bool
+has_hardware()
+{
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+#endif
+
+} // namespace detail
+
+// Extends a finished CRC32C with more data, so that
+// extend(compute(a), b) == compute(a + b).
+inline uint32_t
+extend(uint32_t crc, uint8_t const* data, size_t size)
+{
+  crc = ~crc;
+#ifdef ONCE__CPPUTILS__CRC32C_SSE42
+  if (detail::has_hardware()) {
+    return ~detail::hardware(crc, data, size);
+  }
+#endif
+  return ~detail::software(crc, data, size);
+}
+
+inline uint32_t
+compute(uint8_t const* data, size_t size)
+{
+  return extend(0, data, size);
+}
+
+} // namespace crc32c
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__CRC32C_HPP_
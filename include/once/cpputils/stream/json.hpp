@@ -16,15 +16,26 @@
 #ifndef ONCE__CPPUTILS__STREAM__JSON_HPP_
 #define ONCE__CPPUTILS__STREAM__JSON_HPP_
 
+#include <once/cpputils/stream/sink.hpp>
+
 #include <algorithm>
 #include <array>
-#include <iostream>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace once::cpputils::stream {
 
+// JSON writer. Values are formatted straight into an internal buffer, which
+// is handed to the sink when it fills up, on flush() and on destruction.
 class Json
 {
   enum class Token : uint8_t
@@ -45,51 +56,121 @@ public:
     end
   };
 
+  // Member name. It shall outlive the member it names.
   class Identifier
   {
   public:
-    template<class T>
+    template<class T,
+             typename = std::enable_if_t<
+               !std::is_same<std::decay_t<T>, std::string>::value>>
     Identifier(T&& data)
       : data_{ std::forward<T>(data) }
     {
     }
 
-    explicit operator std::string() { return data_; }
+    Identifier(std::string const& data)
+      : data_{ data }
+    {
+    }
+
+    // A temporary string would leave the name dangling.
+    Identifier(std::string&& data) = delete;
+    Identifier(std::string const&& data) = delete;
+
+    explicit operator std::string_view() const { return data_; }
 
   private:
-    std::string data_;
+    std::string_view data_;
   };
 
   template<class T>
   using Member = std::pair<Identifier, T>;
 
+  static constexpr size_t buffer_size = 4096;
+  static constexpr int max_fixed_precision = 64;
+
 public:
-  Json(std::iostream& os);
+  explicit Json(Sink& sink);
+  ~Json();
+
+  Json(Json const&) = delete;
+  Json& operator=(Json const&) = delete;
 
   Json& operator<<(Object object);
   template<typename T>
   Json& operator<<(const Member<T>& member);
 
+  // Hands the buffered output to the sink.
+  void flush();
+
+  // Floating-point values are written in the shortest form that reads back
+  // to the same value, or, in fixed precision mode, with the given number of
+  // decimals, up to max_fixed_precision.
+  std::optional<int> fixed_precision() const { return fixed_precision_; }
+
+  void set_fixed_precision(std::optional<int> decimals);
+
 private:
+  void write(bool value);
+  template<typename T,
+           std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
+  void write(T value);
+  void write(char const* string);
+  void write(std::string_view string);
   template<typename T>
-  Json& operator<<(std::decay_t<T*> pointer);
+  void write(T const* pointer);
   template<typename T>
-  Json& operator<<(const std::vector<T>& vector);
+  void write(const std::vector<T>& vector);
   template<typename T, size_t N>
-  Json& operator<<(const std::array<T, N>& array);
+  void write(const std::array<T, N>& array);
   template<typename T>
-  Json& operator<<(const std::optional<T>& optional);
+  void write(const std::optional<T>& optional);
+
+  template<typename I>
+  void write_items(I first, I last);
+  void write_escaped(std::string_view string);
+
+  void put(char c);
+  void append(char const* data, size_t size);
+  // Room for size more bytes in the buffer. It shall not exceed buffer_size.
+  char* reserve(size_t size);
 
 private:
-  std::iostream stream_;
+  Sink& sink_;
   Token last_token_;
+  std::optional<int> fixed_precision_;
+  size_t size_;
+  std::array<char, buffer_size> buffer_;
 };
 
-inline Json::Json(std::iostream& stream)
-  : stream_{ stream }
+inline Json::Json(Sink& sink)
+  : sink_{ sink }
   , last_token_{ Token::none }
+  , size_{ 0 }
+{
+}
+
+inline Json::~Json()
 {
-  stream_ << std::boolalpha;
+  flush();
+}
+
+inline void
+Json::set_fixed_precision(std::optional<int> decimals)
+{
+  if (decimals) {
+    decimals = std::clamp(*decimals, 0, max_fixed_precision);
+  }
+  fixed_precision_ = decimals;
+}
+
+inline void
+Json::flush()
+{
+  if (0 < size_) {
+    sink_.write(buffer_.data(), size_);
+    size_ = 0;
+  }
 }
 
 inline Json&
@@ -97,11 +178,11 @@ Json::operator<<(Object object)
 {
   switch (object) {
     case Object::begin:
-      stream_ << '{';
+      put('{');
       last_token_ = Token::left_brace;
       break;
     case Object::end:
-      stream_ << '}';
+      put('}');
       last_token_ = Token::right_brace;
       break;
   }
@@ -114,60 +195,200 @@ Json::operator<<(const Member<T>& member)
 {
   if (Token::left_brace == last_token_ || Token::value == last_token_) {
     if (Token::value == last_token_) {
-      stream_ << ',';
+      put(',');
     }
-    stream_ << '"' << member.first << '"' << ":" << member.second;
+    put('"');
+    write_escaped(static_cast<std::string_view>(member.first));
+    append("\":", 2);
+    write(member.second);
     last_token_ = Token::value;
   }
   return *this;
 }
 
-template<typename T>
-inline Json&
-Json::operator<<(std::decay_t<T*> pointer)
+inline void
+Json::write(bool value)
 {
-  stream_ << (nullptr != pointer) ? pointer : "null";
-  return *this;
+  if (value) {
+    append("true", 4);
+  } else {
+    append("false", 5);
+  }
+}
+
+template<typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool>>
+inline void
+Json::write(T value)
+{
+  if constexpr (std::is_same_v<T, long double>) {
+    // JSON numbers are read back as doubles anyway.
+    write(static_cast<double>(value));
+  } else if constexpr (std::is_floating_point_v<T>) {
+    // JSON has no representation for them.
+    if (!std::isfinite(value)) {
+      append("null", 4);
+      return;
+    }
+    // Fixed notation spells out every integer digit, next to a sign, a point
+    // and the decimals.
+    constexpr size_t max_size = std::numeric_limits<T>::max_exponent10 + 3 +
+                                max_fixed_precision;
+    char* first = reserve(max_size);
+    char* last = first + max_size;
+    if (fixed_precision_) {
+      last =
+        std::to_chars(
+          first, last, value, std::chars_format::fixed, *fixed_precision_)
+          .ptr;
+    } else {
+      last = std::to_chars(first, last, value).ptr;
+    }
+    size_ += last - first;
+  } else {
+    constexpr size_t max_size = std::numeric_limits<T>::digits10 + 2;
+    char* first = reserve(max_size);
+    size_ += std::to_chars(first, first + max_size, value).ptr - first;
+  }
+}
+
+inline void
+Json::write(char const* string)
+{
+  if (nullptr == string) {
+    append("null", 4);
+  } else {
+    write(std::string_view{ string });
+  }
+}
+
+inline void
+Json::write(std::string_view string)
+{
+  put('"');
+  write_escaped(string);
+  put('"');
 }
 
 template<typename T>
-inline Json&
-Json::operator<<(const std::vector<T>& vector)
-{
-  stream_ << '[';
-  if (!vector.empty()) {
-    stream_ << vector.front();
-    std::for_each(++vector.begin(), vector.end(), [&vector](auto&& item) {
-      stream_ << ',' << item;
-    });
+inline void
+Json::write(T const* pointer)
+{
+  if (nullptr == pointer) {
+    append("null", 4);
+  } else {
+    write(*pointer);
   }
-  stream_ << ']';
-  return *this;
+}
+
+template<typename T>
+inline void
+Json::write(const std::vector<T>& vector)
+{
+  write_items(vector.begin(), vector.end());
 }
 
 template<typename T, size_t N>
-inline Json&
-Json::operator<<(const std::array<T, N>& array)
-{
-  stream_ << '[';
-  if constexpr (N > 0) {
-    stream_ << array.front();
-    std::for_each(++array.begin(), array.end(), [&array](auto&& item) {
-      stream_ << ',' << item;
-    });
-  }
-  stream_ << ']';
-  return *this;
+inline void
+Json::write(const std::array<T, N>& array)
+{
+  write_items(array.begin(), array.end());
 }
 
 template<typename T>
-inline Json&
-Json::operator<<(const std::optional<T>& optional)
+inline void
+Json::write(const std::optional<T>& optional)
 {
-  stream_ << (optional) ? *optional << "null";
-  return *this;
+  if (optional) {
+    write(*optional);
+  } else {
+    append("null", 4);
+  }
+}
+
+template<typename I>
+inline void
+Json::write_items(I first, I last)
+{
+  put('[');
+  for (I it = first; it != last; ++it) {
+    if (it != first) {
+      put(',');
+    }
+    write(*it);
+  }
+  put(']');
+}
+
+// Runs of characters that need no escaping are copied as a whole.
+inline void
+Json::write_escaped(std::string_view string)
+{
+  static constexpr char hex[] = "0123456789abcdef";
+  size_t begin = 0;
+  for (size_t i = 0; i < string.size(); ++i) {
+    const auto c = static_cast<unsigned char>(string[i]);
+    if (('"' != c) && ('\\' != c) && (0x20 <= c)) {
+      continue;
+    }
+    append(string.data() + begin, i - begin);
+    begin = i + 1;
+    switch (c) {
+      case '"':
+        append("\\\"", 2);
+        break;
+      case '\\':
+        append("\\\\", 2);
+        break;
+      case '\n':
+        append("\\n", 2);
+        break;
+      case '\r':
+        append("\\r", 2);
+        break;
+      case '\t':
+        append("\\t", 2);
+        break;
+      default: {
+        const char escaped[] = {
+          '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]
+        };
+        append(escaped, sizeof(escaped));
+      }
+    }
+  }
+  append(string.data() + begin, string.size() - begin);
+}
+
+inline void
+Json::put(char c)
+{
+  *reserve(1) = c;
+  ++size_;
+}
+
+inline void
+Json::append(char const* data, size_t size)
+{
+  if (buffer_size - size_ < size) {
+    flush();
+    if (buffer_size <= size) {
+      sink_.write(data, size);
+      return;
+    }
+  }
+  std::memcpy(buffer_.data() + size_, data, size);
+  size_ += size;
+}
+
+inline char*
+Json::reserve(size_t size)
+{
+  if (buffer_size - size_ < size) {
+    flush();
+  }
+  return buffer_.data() + size_;
 }
 
 } // namespace once::cpputils::stream
 
-#endif // ONCE__CPPUTILS__STREAM__JSON_HPP_
\ No newline at end of file
+#endif // ONCE__CPPUTILS__STREAM__JSON_HPP_
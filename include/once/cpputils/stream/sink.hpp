@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__SINK_HPP_
+#define ONCE__CPPUTILS__STREAM__SINK_HPP_
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#define ONCE__CPPUTILS__STREAM_FD_SINK
+#endif
+
+namespace once::cpputils::stream {
+
+// Destination of formatted bytes. Writers buffer their output and hand it
+// over in large blocks, so the indirect call stays off their hot path.
+class Sink
+{
+public:
+  virtual ~Sink() = default;
+
+  virtual void write(char const* data, size_t size) = 0;
+};
+
+// Growable in-memory sink.
+class StringSink : public Sink
+{
+public:
+  void write(char const* data, size_t size) override
+  {
+    string_.append(data, size);
+  }
+
+  std::string const& str() const { return string_; }
+
+  // Moves the bytes out, leaving the sink empty.
+  std::string release() { return std::exchange(string_, std::string{}); }
+
+private:
+  std::string string_;
+};
+
+// Writes into a caller's array, e.g. a stack buffer for a log line. A write
+// that does not fit is dropped along with every later one, so check
+// overflowed() before taking data() as a complete document.
+class FixedSink : public Sink
+{
+public:
+  FixedSink(char* data, size_t capacity)
+    : data_{ data }
+    , capacity_{ capacity }
+  {
+  }
+
+  void write(char const* data, size_t size) override
+  {
+    if (overflowed_ || (capacity_ - size_ < size)) {
+      overflowed_ = true;
+      return;
+    }
+    std::memcpy(data_ + size_, data, size);
+    size_ += size;
+  }
+
+  char const* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool overflowed() const { return overflowed_; }
+
+private:
+  char* data_;
+  size_t capacity_;
+  size_t size_ = 0;
+  bool overflowed_ = false;
+};
+
+#ifdef ONCE__CPPUTILS__STREAM_FD_SINK
+// Writes to a file descriptor it does not own. After a failed write, the
+// error is kept and later writes are dropped.
+class FdSink : public Sink
+{
+public:
+  explicit FdSink(int fd)
+    : fd_{ fd }
+  {
+  }
+
+  void write(char const* data, size_t size) override
+  {
+    while ((0 == error_) && (0 < size)) {
+      const ssize_t written = ::write(fd_, data, size);
+      if (0 < written) {
+        data += written;
+        size -= written;
+      } else if (0 == written) {
+        // Nothing written for a non-empty request would repeat forever.
+        error_ = EIO;
+      } else if (EINTR != errno) {
+        error_ = errno;
+      }
+    }
+  }
+
+  int fd() const { return fd_; }
+  bool failed() const { return 0 != error_; }
+  int error() const { return error_; }
+
+private:
+  int fd_;
+  int error_ = 0;
+};
+#endif
+
+} // namespace once::cpputils::stream
+
+#endif // ONCE__CPPUTILS__STREAM__SINK_HPP_
@@ -16,10 +16,15 @@
 #ifndef ONCE__CPPUTILS__STREAM__XCDR2_HPP_
 #define ONCE__CPPUTILS__STREAM__XCDR2_HPP_
 
+#include <once/cpputils/stream/crc32c.hpp>
+
 #include <algorithm>
 #include <array>
 #include <cstdint>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace once {
@@ -35,7 +40,7 @@ enum class Endian
   native = little
 #else
   little = __ORDER_LITTLE_ENDIAN__,
-  big = __ORDER_LITTLE_ENDIAN__,
+  big = __ORDER_BIG_ENDIAN__,
   native = __BYTE_ORDER__
 #endif
 };
@@ -48,6 +53,14 @@ enum class StreamState : uint8_t
   error
 };
 
+enum class Trailer : uint8_t
+{
+  none,
+  crc32c
+};
+
+class Graph;
+
 struct StreamBase
 {
   size_t ser_length() { return ser_length_; }
@@ -56,6 +69,12 @@ struct StreamBase
   StreamState ser_state() { return ser_state_; }
   StreamState deser_state() { return deser_state_; }
 
+  // For decoders layered on top, which reject data the stream accepted.
+  void set_deser_error() { deser_state_ = StreamState::error; }
+
+  // For encoders layered on top, which reject data the stream would accept.
+  void set_ser_error() { ser_state_ = StreamState::error; }
+
 protected:
   template<typename U>
   static const uint8_t* constant_cast(U* ptr)
@@ -94,12 +113,197 @@ protected:
     return Aligner<U, sizeof(U)>::padding(current_size);
   }
 
+  static size_t padding(size_t current_size, size_t alignment)
+  {
+    const size_t remainder = current_size & (alignment - 1);
+    return (remainder) ? (alignment - remainder) : 0;
+  }
+
   size_t ser_length_ = 0;
   size_t deser_length_ = 0;
   StreamState ser_state_ = StreamState::ok;
   StreamState deser_state_ = StreamState::ok;
 };
 
+// Marks a key member. A stream in key-only mode skips everything that is not
+// inside a key.
+template<typename T>
+struct Key
+{
+  T& value;
+};
+
+template<typename T>
+Key<T>
+key(T& value)
+{
+  return Key<T>{ value };
+}
+
+// Opt-in bit packed encoding of a bool sequence: the length in bits followed
+// by one bit per element, least significant bit first. A reader expecting
+// plain XCDR2 would take the bytes for one bool each, so the receiving end
+// shall decode the member as packed too.
+template<typename T>
+struct Packed
+{
+  T& value;
+};
+
+template<typename T>
+Packed<T>
+packed(T& value)
+{
+  return Packed<T>{ value };
+}
+
+// Any range encoded as a sequence: its length followed by its elements.
+// Ranges without size() shall be forward ranges, as they are walked twice.
+// An lvalue range is referred to, while a temporary one is kept by value.
+// Deserialization needs clear(), emplace_back() and pop_back(), like
+// std::deque or std::list. A failed deserialization keeps the elements
+// decoded before the error and drops the one it fails on.
+template<typename R>
+struct Sequence
+{
+  mutable R value;
+};
+
+template<typename R>
+struct Sequence<R&>
+{
+  R& value;
+};
+
+template<typename R>
+Sequence<R>
+sequence(R&& value)
+{
+  return Sequence<R>{ std::forward<R>(value) };
+}
+
+namespace detail {
+
+template<typename R>
+using range_value_t = std::remove_cv_t<
+  std::remove_reference_t<decltype(*std::begin(std::declval<R&>()))>>;
+
+template<typename R, typename = void>
+struct is_sized_range : std::false_type
+{
+};
+
+template<typename R>
+struct is_sized_range<R, std::void_t<decltype(std::size(std::declval<R&>()))>>
+  : std::true_type
+{
+};
+
+// Ranges whose elements are adjacent in memory, found through data().
+template<typename R, typename = void>
+struct is_contiguous_range : std::false_type
+{
+};
+
+template<typename R>
+struct is_contiguous_range<
+  R,
+  std::void_t<decltype(std::data(std::declval<R&>()))>>
+  : std::conjunction<
+      is_sized_range<R>,
+      std::is_same<decltype(std::data(std::declval<R&>())),
+                   std::add_pointer_t<std::remove_reference_t<
+                     decltype(*std::begin(std::declval<R&>()))>>>>
+{
+};
+
+} // namespace detail
+
+// Read-only view over a deserialized sequence of arithmetic values. It points
+// straight into the stream buffer when the data is native endian and aligned
+// for T, and owns a copy otherwise. A borrowed view is valid until the buffer
+// is modified, released or destroyed.
+template<typename T>
+class Span
+{
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>);
+
+  template<Endian, typename>
+  friend struct Stream;
+
+public:
+  using value_type = T;
+  using const_iterator = T const*;
+
+  T const* data() const { return borrowed_ ? borrowed_data_ : storage_.data(); }
+  size_t size() const { return size_; }
+  bool empty() const { return 0 == size_; }
+
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size_; }
+
+  T const& operator[](size_t index) const { return data()[index]; }
+
+  bool borrowed() const { return borrowed_; }
+
+private:
+  T const* borrowed_data_ = nullptr;
+  size_t size_ = 0;
+  bool borrowed_ = false;
+  std::vector<T> storage_;
+};
+
+// Operations a buffer shall provide to back a Stream. The serialized data is
+// only appended to, while the deserialization reads it at any position.
+template<typename T>
+struct BufferTraits
+{
+};
+
+template<typename A>
+struct BufferTraits<std::vector<uint8_t, A>>
+{
+  using buffer_type = std::vector<uint8_t, A>;
+
+  static size_t size(buffer_type const& buffer) { return buffer.size(); }
+
+  static void append(buffer_type& buffer, uint8_t const* data, size_t size)
+  {
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  // Explicit zeros, as the allocator may leave resized bytes uninitialized.
+  static void append_zeros(buffer_type& buffer, size_t size)
+  {
+    buffer.insert(buffer.end(), size, 0);
+  }
+
+  static void copy(buffer_type const& buffer,
+                   size_t position,
+                   uint8_t* data,
+                   size_t size)
+  {
+    std::copy_n(buffer.data() + position, size, data);
+  }
+
+  // Pointer to size contiguous bytes, or nullptr if they are split.
+  static uint8_t const* contiguous(buffer_type const& buffer,
+                                   size_t position,
+                                   size_t /* size */)
+  {
+    return buffer.data() + position;
+  }
+
+  template<typename F>
+  static void for_each_chunk(buffer_type const& buffer,
+                             size_t position,
+                             size_t size,
+                             F&& function)
+  {
+    function(buffer.data() + position, size);
+  }
+};
+
 template<typename T>
 struct StreamBuffer
 {
@@ -110,31 +314,77 @@ protected:
   T buffer_;
 };
 
-template<Endian E, typename T>
+// Deserialization writes into the given object and reuses its storage:
+// strings and sequences are resized in place, so they allocate nothing while
+// a message fits in their current capacity. Sequences keep their existing
+// elements, and with them the elements' own capacity, unless a message makes
+// them shorter. Decoding messages of a steady shape into the same object thus
+// allocates nothing after the first one.
+template<Endian E, typename B>
 struct Stream
-{
-};
-
-template<Endian E>
-struct Stream<E, std::vector<uint8_t>>
   : public StreamBase
-  , public StreamBuffer<std::vector<uint8_t>>
+  , public StreamBuffer<B>
 {
+  Stream() = default;
+
+  // Takes over serialized data to deserialize it.
+  explicit Stream(B&& buffer) { adopt(std::move(buffer)); }
+
+  void adopt(B&& buffer)
+  {
+    reset();
+    buffer_ = std::move(buffer);
+    ser_length_ = Traits::size(buffer_);
+  }
+
+  // Moves the buffer out, leaving the stream empty. The trailer and key-only
+  // modes are kept.
+  B release()
+  {
+    B buffer{ std::move(buffer_) };
+    buffer_ = B{};
+    reset();
+    return buffer;
+  }
+
+  // Bytes left to deserialize, the CRC32C trailer excluded.
+  size_t deser_remaining() const
+  {
+    const size_t end = deser_end();
+    return (deser_length_ <= end) ? end - deser_length_ : 0;
+  }
+
+  // Moves the deserialization to a known offset, so that a part of the buffer
+  // can be decoded on its own. Alignment stays relative to the start of the
+  // buffer. A CRC32C trailer is only verified by reading from the start, so
+  // seeking is an error in that mode.
+  Stream& seek(size_t position)
+  {
+    if ((Trailer::crc32c == trailer_) || (deser_end() < position)) {
+      deser_state_ = StreamState::error;
+    } else {
+      deser_length_ = position;
+    }
+    return *this;
+  }
+
   template<typename T,
            typename = std::enable_if_t<std::is_arithmetic<T>::value>>
   Stream& operator<<(T const& data)
   {
-    ser_length_ += padding<T>(ser_length_);
-    buffer_.resize(ser_length_);
+    if (skipped()) {
+      return *this;
+    }
+    append_zeros(padding<T>(ser_length_));
     auto ptr = constant_cast(&data);
     if constexpr (E == Endian::native) {
-      buffer_.insert(buffer_.begin() + ser_length_, ptr, ptr + sizeof(T));
+      append(ptr, sizeof(T));
     } else {
-      buffer_.insert(buffer_.begin() + ser_length_,
-                     std::reverse_iterator(ptr + sizeof(T)),
-                     std::reverse_iterator(ptr));
+      uint8_t swapped[sizeof(T)];
+      std::reverse_copy(ptr, ptr + sizeof(T), swapped);
+      append(swapped, sizeof(T));
     }
-    ser_length_ += sizeof(T);
+    update_ser_crc();
     return *this;
   }
 
@@ -143,16 +393,16 @@ struct Stream<E, std::vector<uint8_t>>
   Stream& operator>>(T& data)
   {
     size_t padding{ this->padding<T>(deser_length_) };
-    size_t future_size = deser_length_ + padding + sizeof(T);
-    if (buffer_.size() >= future_size) {
-      auto ptr = cast(&data);
-      auto it = buffer_.begin() + deser_length_ + padding;
+    if (readable(padding + sizeof(T))) {
+      deser_length_ += padding;
       if constexpr (E == Endian::native) {
-        std::copy(it, it + sizeof(T), ptr);
+        consume(cast(&data), sizeof(T));
       } else {
-        std::reverse_copy(it, it + sizeof(T), ptr);
+        uint8_t swapped[sizeof(T)];
+        consume(swapped, sizeof(T));
+        std::reverse_copy(swapped, swapped + sizeof(T), cast(&data));
       }
-      deser_length_ = future_size;
+      update_deser_crc();
     } else {
       deser_state_ = StreamState::error;
     }
@@ -160,54 +410,308 @@ struct Stream<E, std::vector<uint8_t>>
     return *this;
   }
 
+  // In key-only mode, strings carry their terminating NUL, counted in their
+  // length, as the DDS-XTypes key hash serializes them.
   Stream& operator<<(std::string const& data)
   {
+    if (skipped()) {
+      return *this;
+    }
     uint32_t length = data.length();
-    *this << length;
-    buffer_.resize(ser_length_ + length);
-    std::copy(data.begin(), data.end(), buffer_.begin() + ser_length_);
-    ser_length_ += length;
+    *this << static_cast<uint32_t>(length + (key_only_ ? 1 : 0));
+    append(constant_cast(data.data()), length);
+    if (key_only_) {
+      append_zeros(1);
+    }
+    update_ser_crc();
     return *this;
   }
 
   Stream& operator>>(std::string& data)
   {
-    uint32_t length;
+    uint32_t length{};
     *this >> length;
-    data.resize(length);
-    std::copy(buffer_.begin() + deser_length_,
-              buffer_.begin() + deser_length_ + length,
-              data.data());
-    deser_length_ += length;
+    if (StreamState::ok == deser_state_) {
+      if (readable(length)) {
+        data.clear();
+        consume_chunks(length, [&data](uint8_t const* ptr, size_t size) {
+          data.append(static_cast<char const*>(static_cast<void const*>(ptr)),
+                      size);
+        });
+        update_deser_crc();
+      } else {
+        deser_state_ = StreamState::error;
+      }
+    }
     return *this;
   }
 
   template<typename T>
   Stream& operator<<(std::vector<T> const& data)
   {
+    if (skipped()) {
+      return *this;
+    }
     uint32_t length = data.size();
     *this << length;
-    std::for_each(
-      data.begin(), data.end(), [this](auto&& item) { *this << item; });
+    if constexpr (std::is_arithmetic_v<T>) {
+      ser_elements(data.data(), data.size());
+    } else {
+      std::for_each(
+        data.begin(), data.end(), [this](auto&& item) { *this << item; });
+    }
     return *this;
   }
 
   template<typename T>
   Stream& operator>>(std::vector<T>& data)
   {
-    uint32_t length;
+    uint32_t length{};
     *this >> length;
-    data.resize(length);
-    std::for_each(
-      data.begin(), data.end(), [this](auto&& item) { *this >> item; });
+    if constexpr (std::is_arithmetic_v<T>) {
+      if (StreamState::ok == deser_state_) {
+        deser_elements(data, length);
+      }
+    } else if (StreamState::ok == deser_state_) {
+      // Grown while decoding, so that a corrupt length fails at the end of the
+      // buffer rather than allocating all of its elements upfront. Nothing is
+      // reserved, as an element may take far more memory than its encoding.
+      uint32_t i = 0;
+      for (; (i < length) && (StreamState::ok == deser_state_); ++i) {
+        if (data.size() == i) {
+          data.emplace_back();
+        }
+        *this >> data[i];
+      }
+      data.resize(i);
+    }
+    return *this;
+  }
+
+  Stream& operator<<(std::vector<bool> const& data)
+  {
+    if (skipped()) {
+      return *this;
+    }
+    uint32_t length = data.size();
+    *this << length;
+    uint8_t chunk[chunk_size];
+    for (auto it = data.begin(); it != data.end();) {
+      const size_t size = std::min<size_t>(chunk_size, data.end() - it);
+      std::copy_n(it, size, chunk);
+      append(chunk, size);
+      it += size;
+    }
+    update_ser_crc();
+    return *this;
+  }
+
+  Stream& operator>>(std::vector<bool>& data)
+  {
+    uint32_t length{};
+    *this >> length;
+    if (StreamState::ok == deser_state_) {
+      if (readable(length)) {
+        data.clear();
+        consume_chunks(length, [&data](uint8_t const* ptr, size_t size) {
+          data.insert(data.end(), ptr, ptr + size);
+        });
+        update_deser_crc();
+      } else {
+        deser_state_ = StreamState::error;
+      }
+    }
+    return *this;
+  }
+
+  Stream& operator<<(Packed<std::vector<bool> const> const& data)
+  {
+    if (skipped()) {
+      return *this;
+    }
+    uint32_t length = data.value.size();
+    *this << length;
+    uint8_t chunk[chunk_size];
+    size_t size = 0;
+    auto it = data.value.begin();
+    for (uint32_t i = 0; i < length; i += 8) {
+      const uint32_t bits = std::min<uint32_t>(8, length - i);
+      uint8_t byte = 0;
+      for (uint32_t bit = 0; bit < bits; ++bit, ++it) {
+        byte |= static_cast<uint8_t>(*it) << bit;
+      }
+      chunk[size++] = byte;
+      if (chunk_size == size) {
+        append(chunk, size);
+        size = 0;
+      }
+    }
+    append(chunk, size);
+    update_ser_crc();
+    return *this;
+  }
+
+  Stream& operator<<(Packed<std::vector<bool>> const& data)
+  {
+    return *this << packed(std::as_const(data.value));
+  }
+
+  Stream& operator>>(Packed<std::vector<bool>> const& data)
+  {
+    uint32_t length{};
+    *this >> length;
+    if (StreamState::ok == deser_state_) {
+      const size_t size = (size_t(length) + 7) / 8;
+      if (readable(size)) {
+        data.value.resize(length);
+        auto it = data.value.begin();
+        size_t remaining = length;
+        consume_chunks(size, [&it, &remaining](uint8_t const* ptr, size_t n) {
+          for (size_t byte = 0; byte < n; ++byte) {
+            const size_t bits = std::min<size_t>(8, remaining);
+            for (size_t bit = 0; bit < bits; ++bit, ++it) {
+              *it = (ptr[byte] >> bit) & 1;
+            }
+            remaining -= bits;
+          }
+        });
+        update_deser_crc();
+      } else {
+        deser_state_ = StreamState::error;
+      }
+    }
+    return *this;
+  }
+
+  template<typename T>
+  Stream& operator>>(Span<T>& data)
+  {
+    uint32_t length{};
+    *this >> length;
+    if (StreamState::ok != deser_state_) {
+      return *this;
+    }
+    const size_t padding = (0 < length) ? this->padding<T>(deser_length_) : 0;
+    const size_t size = size_t(length) * sizeof(T);
+    if (!readable(padding + size)) {
+      deser_state_ = StreamState::error;
+      return *this;
+    }
+
+    deser_length_ += padding;
+    data.size_ = length;
+    data.borrowed_ = false;
+    if constexpr (E == Endian::native) {
+      auto ptr =
+        (0 < size) ? Traits::contiguous(buffer_, deser_length_, size) : nullptr;
+      if ((nullptr != ptr) &&
+          (0 == reinterpret_cast<uintptr_t>(ptr) % alignof(T))) {
+        data.borrowed_data_ =
+          static_cast<T const*>(static_cast<void const*>(ptr));
+        data.borrowed_ = true;
+        deser_length_ += size;
+      } else {
+        data.storage_.resize(length);
+        consume(cast(data.storage_.data()), size);
+      }
+    } else {
+      data.storage_.resize(length);
+      consume(cast(data.storage_.data()), size);
+      for (auto&& element : data.storage_) {
+        auto ptr = cast(&element);
+        std::reverse(ptr, ptr + sizeof(T));
+      }
+    }
+    update_deser_crc();
+    return *this;
+  }
+
+  // Raw bytes are copied verbatim, after padding the stream up to the given
+  // alignment. The alignment shall be a power of two.
+  Stream& write(uint8_t const* data, size_t size, size_t alignment = 1)
+  {
+    if (skipped()) {
+      return *this;
+    }
+    append_zeros(padding(ser_length_, alignment));
+    append(data, size);
+    update_ser_crc();
+    return *this;
+  }
+
+  Stream& read(uint8_t* data, size_t size, size_t alignment = 1)
+  {
+    const size_t padding = this->padding(deser_length_, alignment);
+    if (readable(padding + size)) {
+      deser_length_ += padding;
+      consume(data, size);
+      update_deser_crc();
+    } else {
+      deser_state_ = StreamState::error;
+    }
     return *this;
   }
 
   template<typename T, size_t N>
   Stream& operator<<(std::array<T, N> const& data)
   {
-    std::for_each(
-      data.begin(), data.end(), [this](auto&& item) { *this << item; });
+    if constexpr (std::is_arithmetic_v<T>) {
+      if (!skipped()) {
+        ser_elements(data.data(), N);
+      }
+    } else {
+      std::for_each(
+        data.begin(), data.end(), [this](auto&& item) { *this << item; });
+    }
+    return *this;
+  }
+
+  template<typename R>
+  Stream& operator<<(Sequence<R> const& data)
+  {
+    if (skipped()) {
+      return *this;
+    }
+    using T = detail::range_value_t<R>;
+    auto&& range = data.value;
+    if constexpr (detail::is_contiguous_range<R>::value &&
+                  std::is_arithmetic_v<T>) {
+      *this << static_cast<uint32_t>(std::size(range));
+      ser_elements(std::data(range), std::size(range));
+    } else {
+      if constexpr (detail::is_sized_range<R>::value) {
+        *this << static_cast<uint32_t>(std::size(range));
+      } else {
+        using C = typename std::iterator_traits<decltype(std::begin(
+          range))>::iterator_category;
+        static_assert(std::is_base_of_v<std::forward_iterator_tag, C>,
+                      "unsized ranges shall be forward ranges");
+        *this << static_cast<uint32_t>(
+          std::distance(std::begin(range), std::end(range)));
+      }
+      for (auto&& item : range) {
+        *this << item;
+      }
+    }
+    return *this;
+  }
+
+  template<typename R>
+  Stream& operator>>(Sequence<R> const& data)
+  {
+    uint32_t length{};
+    *this >> length;
+    if (StreamState::ok == deser_state_) {
+      data.value.clear();
+      for (uint32_t i = 0; (i < length) && (StreamState::ok == deser_state_);
+           ++i) {
+        data.value.emplace_back();
+        *this >> data.value.back();
+        if (StreamState::ok != deser_state_) {
+          data.value.pop_back();
+        }
+      }
+    }
     return *this;
   }
 
@@ -218,6 +722,274 @@ struct Stream<E, std::vector<uint8_t>>
       data.begin(), data.end(), [this](auto&& item) { *this >> item; });
     return *this;
   }
+
+  template<typename T>
+  Stream& operator<<(Key<T> const& data)
+  {
+    ++key_depth_;
+    *this << static_cast<T const&>(data.value);
+    --key_depth_;
+    return *this;
+  }
+
+  template<typename T>
+  Stream& operator>>(Key<T> const& data)
+  {
+    return *this >> data.value;
+  }
+
+  bool key_only() const { return key_only_; }
+
+  void set_key_only(bool key_only) { key_only_ = key_only; }
+
+  // Whether what is serialized now is dropped, i.e. in key-only mode outside
+  // of a key.
+  bool skipped() const { return key_only_ && (0 == key_depth_); }
+
+  // In graph mode, the targets of shared references are encoded once per
+  // graph, see xcdr2_graph.hpp. The graph shall outlive its use.
+  Graph* graph() const { return graph_; }
+
+  void set_graph(Graph* graph) { graph_ = graph; }
+
+  // With a CRC32C trailer, the checksum is computed while the bytes are
+  // written or read. seal() appends it to the serialized data and verify()
+  // checks it once the deserialization is done. The trailer mode shall be set
+  // before the first write or read. Sealing again appends nothing.
+  Trailer trailer() const { return trailer_; }
+
+  void set_trailer(Trailer trailer) { trailer_ = trailer; }
+
+  Stream& seal()
+  {
+    if ((Trailer::crc32c == trailer_) && !sealed_) {
+      sealed_ = true;
+      ser_crc_ = extend_crc(ser_crc_, ser_crc_length_, ser_length_);
+      ser_crc_length_ = ser_length_;
+      auto ptr = constant_cast(&ser_crc_);
+      uint8_t bytes[sizeof(ser_crc_)];
+      if constexpr (E == Endian::native) {
+        std::copy(ptr, ptr + sizeof(ser_crc_), bytes);
+      } else {
+        std::reverse_copy(ptr, ptr + sizeof(ser_crc_), bytes);
+      }
+      append(bytes, sizeof(bytes));
+    }
+    return *this;
+  }
+
+  bool verify()
+  {
+    if ((Trailer::crc32c == trailer_) && (StreamState::ok == deser_state_)) {
+      const size_t end = deser_end();
+      if ((Traits::size(buffer_) < sizeof(uint32_t)) ||
+          (deser_crc_length_ > end)) {
+        deser_state_ = StreamState::error;
+        return false;
+      }
+      deser_crc_ = extend_crc(deser_crc_, deser_crc_length_, end);
+      deser_crc_length_ = end;
+      uint32_t crc;
+      uint8_t bytes[sizeof(crc)];
+      Traits::copy(buffer_, end, bytes, sizeof(bytes));
+      if constexpr (E == Endian::native) {
+        std::copy(bytes, bytes + sizeof(crc), cast(&crc));
+      } else {
+        std::reverse_copy(bytes, bytes + sizeof(crc), cast(&crc));
+      }
+      if (crc != deser_crc_) {
+        deser_state_ = StreamState::error;
+      }
+    }
+    return StreamState::ok == deser_state_;
+  }
+
+private:
+  using Traits = BufferTraits<B>;
+  using StreamBuffer<B>::buffer_;
+
+  // Bytes are checksummed in chunks small enough to still be in cache.
+  static constexpr size_t crc_chunk = 4096;
+
+  // Scratch size for data that is converted on its way to the buffer.
+  static constexpr size_t chunk_size = 256;
+
+  void reset()
+  {
+    ser_length_ = 0;
+    deser_length_ = 0;
+    ser_state_ = StreamState::ok;
+    deser_state_ = StreamState::ok;
+    key_depth_ = 0;
+    ser_crc_ = 0;
+    ser_crc_length_ = 0;
+    deser_crc_ = 0;
+    deser_crc_length_ = 0;
+    sealed_ = false;
+  }
+
+  // Fixed-capacity buffers drop what does not fit. The serialized length then
+  // stays at what the buffer holds and the serialization fails.
+  void append(uint8_t const* data, size_t size)
+  {
+    Traits::append(buffer_, data, size);
+    appended(size);
+  }
+
+  void append_zeros(size_t size)
+  {
+    if (0 < size) {
+      Traits::append_zeros(buffer_, size);
+      appended(size);
+    }
+  }
+
+  void appended(size_t size)
+  {
+    if (Traits::size(buffer_) == ser_length_ + size) {
+      ser_length_ += size;
+    } else {
+      ser_state_ = StreamState::error;
+    }
+  }
+
+  size_t deser_end() const
+  {
+    const size_t size = Traits::size(buffer_);
+    if (Trailer::crc32c == trailer_) {
+      return (size < sizeof(uint32_t)) ? 0 : size - sizeof(uint32_t);
+    }
+    return size;
+  }
+
+  // Nothing is readable after an error, so that the decoding of a malformed
+  // message stops at its first error instead of going on with garbage.
+  bool readable(size_t size) const
+  {
+    const size_t end = deser_end();
+    return (StreamState::ok == deser_state_) && (deser_length_ <= end) &&
+           (end - deser_length_ >= size);
+  }
+
+  void consume(uint8_t* data, size_t size)
+  {
+    Traits::copy(buffer_, deser_length_, data, size);
+    deser_length_ += size;
+  }
+
+  template<typename F>
+  void consume_chunks(size_t size, F&& function)
+  {
+    Traits::for_each_chunk(
+      buffer_, deser_length_, size, std::forward<F>(function));
+    deser_length_ += size;
+  }
+
+  // Adjacent arithmetic elements share the alignment of the first one, so
+  // they are written in bulk, converted chunk by chunk when not native.
+  template<typename T>
+  void ser_elements(T const* data, size_t length)
+  {
+    if (0 == length) {
+      return;
+    }
+    append_zeros(padding<T>(ser_length_));
+    if constexpr (E == Endian::native) {
+      append(constant_cast(data), length * sizeof(T));
+      update_ser_crc();
+    } else {
+      constexpr size_t chunk_length = chunk_size / sizeof(T);
+      uint8_t chunk[chunk_length * sizeof(T)];
+      while (0 < length) {
+        const size_t n = std::min(length, chunk_length);
+        for (size_t i = 0; i < n; ++i) {
+          auto ptr = constant_cast(data + i);
+          std::reverse_copy(ptr, ptr + sizeof(T), chunk + i * sizeof(T));
+        }
+        append(chunk, n * sizeof(T));
+        update_ser_crc();
+        data += n;
+        length -= n;
+      }
+    }
+  }
+
+  // Arithmetic elements are appended to the cleared sequence, either straight
+  // from the buffer or through a scratch chunk, so that each byte of the
+  // sequence is written once.
+  template<typename T>
+  void deser_elements(std::vector<T>& data, size_t length)
+  {
+    const size_t size = length * sizeof(T);
+    if (!readable(size)) {
+      deser_state_ = StreamState::error;
+      return;
+    }
+    data.clear();
+    if constexpr (E == Endian::native) {
+      auto ptr =
+        (0 < size) ? Traits::contiguous(buffer_, deser_length_, size) : nullptr;
+      if ((nullptr != ptr) &&
+          (0 == reinterpret_cast<uintptr_t>(ptr) % alignof(T))) {
+        auto first = static_cast<T const*>(static_cast<void const*>(ptr));
+        data.assign(first, first + length);
+        deser_length_ += size;
+        update_deser_crc();
+        return;
+      }
+    }
+    constexpr size_t chunk_length = chunk_size / sizeof(T);
+    T chunk[chunk_length];
+    while (0 < length) {
+      const size_t n = std::min(length, chunk_length);
+      consume(cast(chunk), n * sizeof(T));
+      if constexpr (E != Endian::native) {
+        std::for_each(chunk, chunk + n, [](T& item) {
+          std::reverse(cast(&item), cast(&item) + sizeof(T));
+        });
+      }
+      data.insert(data.end(), chunk, chunk + n);
+      length -= n;
+    }
+    update_deser_crc();
+  }
+
+  uint32_t extend_crc(uint32_t crc, size_t begin, size_t end) const
+  {
+    Traits::for_each_chunk(
+      buffer_, begin, end - begin, [&crc](uint8_t const* ptr, size_t size) {
+        crc = crc32c::extend(crc, ptr, size);
+      });
+    return crc;
+  }
+
+  void update_ser_crc()
+  {
+    if ((Trailer::crc32c == trailer_) &&
+        (crc_chunk <= ser_length_ - ser_crc_length_)) {
+      ser_crc_ = extend_crc(ser_crc_, ser_crc_length_, ser_length_);
+      ser_crc_length_ = ser_length_;
+    }
+  }
+
+  void update_deser_crc()
+  {
+    if ((Trailer::crc32c == trailer_) &&
+        (crc_chunk <= deser_length_ - deser_crc_length_)) {
+      deser_crc_ = extend_crc(deser_crc_, deser_crc_length_, deser_length_);
+      deser_crc_length_ = deser_length_;
+    }
+  }
+
+  bool key_only_ = false;
+  Graph* graph_ = nullptr;
+  size_t key_depth_ = 0;
+  Trailer trailer_ = Trailer::none;
+  uint32_t ser_crc_ = 0;
+  size_t ser_crc_length_ = 0;
+  uint32_t deser_crc_ = 0;
+  size_t deser_crc_length_ = 0;
+  bool sealed_ = false;
 };
 
 template<Endian E>
@@ -228,4 +1000,4 @@ using VectorStream = VectorStreamEndian<Endian::native>;
 } // namespace utils
 } // namespace once
 
-#endif // ONCE__CPPUTILS__STREAM__XCDR2_HPP_
\ No newline at end of file
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_HPP_
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_ALIGNED_ALLOCATOR_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_ALIGNED_ALLOCATOR_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+inline constexpr size_t cache_line_size = 64;
+inline constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+// Allocates cache-line aligned storage. On Linux, allocations of at least
+// HugePageThreshold bytes are mapped on huge pages: explicit ones when the
+// system has them reserved, transparent ones otherwise. A mapping is only
+// page aligned, so alignments beyond the page size are always allocated with
+// operator new.
+template<typename T,
+         size_t Alignment = cache_line_size,
+         size_t HugePageThreshold = huge_page_size>
+class AlignedAllocator
+{
+  static_assert((0 < Alignment) && (0 == (Alignment & (Alignment - 1))),
+                "the alignment shall be a power of two");
+
+public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  template<typename U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment, HugePageThreshold>;
+  };
+
+  AlignedAllocator() = default;
+
+  template<typename U>
+  AlignedAllocator(AlignedAllocator<U, Alignment, HugePageThreshold> const&)
+  {
+  }
+
+  size_t max_size() const
+  {
+    return std::numeric_limits<size_t>::max() / sizeof(T);
+  }
+
+  T* allocate(size_t n)
+  {
+    if (max_size() < n) {
+      throw std::bad_array_new_length{};
+    }
+    const size_t size = n * sizeof(T);
+#ifdef __linux__
+    if (mapped(size)) {
+      return static_cast<T*>(map(mapped_size(size)));
+    }
+#endif
+    return static_cast<T*>(::operator new(size, std::align_val_t(alignment)));
+  }
+
+  void deallocate(T* ptr, size_t n)
+  {
+    const size_t size = n * sizeof(T);
+#ifdef __linux__
+    if (mapped(size)) {
+      ::munmap(ptr, mapped_size(size));
+      return;
+    }
+#endif
+    ::operator delete(ptr, std::align_val_t(alignment));
+  }
+
+  template<typename U>
+  bool operator==(
+    AlignedAllocator<U, Alignment, HugePageThreshold> const&) const
+  {
+    return true;
+  }
+
+  template<typename U>
+  bool operator!=(
+    AlignedAllocator<U, Alignment, HugePageThreshold> const&) const
+  {
+    return false;
+  }
+
+private:
+  static constexpr size_t alignment = std::max(Alignment, alignof(T));
+
+#ifdef __linux__
+  static bool mapped(size_t size)
+  {
+    static const size_t page_size =
+      static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return (HugePageThreshold <= size) && (alignment <= page_size);
+  }
+
+  static size_t mapped_size(size_t size)
+  {
+    return (size + huge_page_size - 1) & ~(huge_page_size - 1);
+  }
+
+  static void* map(size_t size)
+  {
+    constexpr int protection = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    ptr = ::mmap(nullptr, size, protection, flags | MAP_HUGETLB, -1, 0);
+#endif
+    if (MAP_FAILED == ptr) {
+      ptr = ::mmap(nullptr, size, protection, flags, -1, 0);
+      if (MAP_FAILED == ptr) {
+        throw std::bad_alloc{};
+      }
+#ifdef MADV_HUGEPAGE
+      ::madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+    }
+    return ptr;
+  }
+#endif
+};
+
+template<Endian E>
+using AlignedStreamEndian =
+  Stream<E, std::vector<uint8_t, AlignedAllocator<uint8_t>>>;
+using AlignedStream = AlignedStreamEndian<Endian::native>;
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_ALIGNED_ALLOCATOR_HPP_
@@ -0,0 +1,543 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_ASYNC_WRITER_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_ASYNC_WRITER_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+#include <once/cpputils/stream/xcdr2_aligned_allocator.hpp>
+#include <once/cpputils/stream/xcdr2_fixed_buffer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) &&            \
+  defined(__NR_io_uring_register)
+#define ONCE__CPPUTILS__XCDR2_IO_URING
+#endif
+#endif
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+enum class WriteBackend : uint8_t
+{
+  // Falls back to pwrite when the kernel does not provide io_uring.
+  io_uring,
+  pwrite
+};
+
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+namespace detail {
+
+// Minimal io_uring, set up through the raw system calls.
+class Ring
+{
+public:
+  Ring() = default;
+  Ring(Ring const&) = delete;
+  Ring& operator=(Ring const&) = delete;
+
+  ~Ring()
+  {
+    if (nullptr != sqes_) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (nullptr != cq_ring_) {
+      ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if ((nullptr != sq_ring_) && (sq_ring_ != cq_ring_)) {
+      ::munmap(sq_ring_, sq_ring_size_);
+    }
+    if (-1 != fd_) {
+      ::close(fd_);
+    }
+  }
+
+  bool setup(unsigned entries)
+  {
+    io_uring_params params{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (-1 == fd_) {
+      return false;
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (nullptr == sq_ring_) {
+      return false;
+    }
+    cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP)
+                 ? sq_ring_
+                 : map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+    if ((nullptr == cq_ring_) || (nullptr == sqes_)) {
+      return false;
+    }
+    auto sq = static_cast<uint8_t*>(sq_ring_);
+    auto cq = static_cast<uint8_t*>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    tail_ = *sq_tail_;
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  bool register_buffers(iovec const* iovecs, unsigned count)
+  {
+    return 0 == ::syscall(__NR_io_uring_register,
+                          fd_,
+                          IORING_REGISTER_BUFFERS,
+                          iovecs,
+                          count);
+  }
+
+  // Next free submission entry, cleared, or nullptr if the queue is full.
+  // The kernel sees it once enter() publishes the tail, so it shall be filled
+  // in by then.
+  io_uring_sqe* next()
+  {
+    if (tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+      return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes_[tail_ & sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[tail_ & sq_mask_] = tail_ & sq_mask_;
+    ++tail_;
+    ++queued_;
+    return sqe;
+  }
+
+  // Submits the queued entries in a single call, optionally waiting for a
+  // completion. Interruptions are retried, and so is a transient shortage of
+  // kernel resources, a few times.
+  bool enter(unsigned wait)
+  {
+    __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+    for (unsigned again = 0;;) {
+      const long submitted = ::syscall(__NR_io_uring_enter,
+                                       fd_,
+                                       queued_,
+                                       wait,
+                                       wait ? IORING_ENTER_GETEVENTS : 0u,
+                                       nullptr,
+                                       0);
+      if (0 <= submitted) {
+        queued_ -= static_cast<unsigned>(submitted);
+        return true;
+      }
+      if (EAGAIN == errno) {
+        if (max_again <= ++again) {
+          return false;
+        }
+        ::sched_yield();
+      } else if (EINTR != errno) {
+        return false;
+      }
+    }
+  }
+
+  // Takes back the queued entries that the kernel has not consumed, which it
+  // only does within enter(), and passes the tag of each one to function.
+  template<typename F>
+  void retract(F&& function)
+  {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    for (unsigned index = head; index != tail_; ++index) {
+      function(sqes_[sq_array_[index & sq_mask_]].user_data);
+    }
+    tail_ = head;
+    queued_ = 0;
+    __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+  }
+
+  // Passes each completion to function. An entry is consumed before function
+  // runs, so function may reap again.
+  template<typename F>
+  void reap(F&& function)
+  {
+    for (;;) {
+      const unsigned head = *cq_head_;
+      if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return;
+      }
+      const io_uring_cqe cqe = cqes_[head & cq_mask_];
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      function(cqe.user_data, cqe.res);
+    }
+  }
+
+private:
+  static constexpr unsigned max_again = 16;
+
+  void* map(size_t size, off_t offset)
+  {
+    void* ptr = ::mmap(nullptr,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE,
+                       fd_,
+                       offset);
+    return (MAP_FAILED == ptr) ? nullptr : ptr;
+  }
+
+  int fd_ = -1;
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned tail_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+  unsigned queued_ = 0;
+};
+
+} // namespace detail
+#endif
+
+// Buffer of an AsyncFileWriter being serialized into. An overflowed buffer is
+// not written.
+class AsyncWriteBuffer : public FixedBuffer
+{
+  friend class AsyncFileWriter;
+
+public:
+  AsyncWriteBuffer() = default;
+
+private:
+  AsyncWriteBuffer(uint8_t* data, size_t capacity, size_t index)
+    : FixedBuffer{ data, capacity }
+    , index_{ index }
+  {
+  }
+
+  size_t index_ = 0;
+};
+
+template<>
+struct BufferTraits<AsyncWriteBuffer> : BufferTraits<FixedBuffer>
+{
+  using buffer_type = AsyncWriteBuffer;
+};
+
+// Appends serialized data to a file without blocking the serialization. The
+// data is serialized straight into one of a few page-aligned buffers, which
+// are registered with io_uring. A submitted buffer is written in the
+// background and recycled once its write completes, so the next message is
+// serialized while the previous one reaches the disk. Submissions are
+// batched: they go to the kernel together on the next acquire() or flush().
+class AsyncFileWriter
+{
+public:
+  AsyncFileWriter(int fd,
+                  size_t buffer_count = 4,
+                  size_t buffer_size = 1024 * 1024,
+                  WriteBackend backend = WriteBackend::io_uring,
+                  uint64_t offset = 0)
+    : fd_{ fd }
+    , buffer_size_{ buffer_size }
+    , offset_{ offset }
+    , storage_(buffer_count * buffer_size)
+    , writes_(buffer_count)
+  {
+    for (size_t index = buffer_count; 0 < index; --index) {
+      free_.push_back(index - 1);
+    }
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+    if ((WriteBackend::io_uring == backend) && (0 < buffer_count) &&
+        ring_.setup(static_cast<unsigned>(2 * buffer_count))) {
+      backend_ = WriteBackend::io_uring;
+      std::vector<iovec> iovecs(buffer_count);
+      for (size_t index = 0; index < buffer_count; ++index) {
+        iovecs[index] = { storage_.data() + index * buffer_size, buffer_size };
+      }
+      fixed_ = ring_.register_buffers(iovecs.data(),
+                                      static_cast<unsigned>(buffer_count));
+    }
+#else
+    (void)backend;
+#endif
+  }
+
+  AsyncFileWriter(AsyncFileWriter const&) = delete;
+  AsyncFileWriter& operator=(AsyncFileWriter const&) = delete;
+
+  ~AsyncFileWriter() { flush(); }
+
+  WriteBackend backend() const { return backend_; }
+
+  // Error once any write or sync failed.
+  StreamState state() const { return state_; }
+
+  // Where the next submitted buffer is written.
+  uint64_t offset() const { return offset_; }
+
+  size_t in_flight() const { return in_flight_; }
+
+  // Free buffer to serialize into, waiting for a write to complete when all
+  // of them are in flight.
+  AsyncWriteBuffer acquire()
+  {
+    progress(free_.empty() && (0 < in_flight_));
+    while (free_.empty() && (0 < in_flight_) &&
+           (StreamState::ok == state_)) {
+      progress(true);
+    }
+    if (free_.empty()) {
+      return AsyncWriteBuffer{};
+    }
+    const size_t index = free_.back();
+    free_.pop_back();
+    return AsyncWriteBuffer{
+      storage_.data() + index * buffer_size_, buffer_size_, index
+    };
+  }
+
+  // Queues the serialized data, to be written after what was submitted
+  // before. An invalid or overflowed buffer is recycled and not written.
+  bool submit(AsyncWriteBuffer&& buffer)
+  {
+    AsyncWriteBuffer submitted{ std::move(buffer) };
+    if (!submitted.valid()) {
+      return false;
+    }
+    const size_t index = submitted.index_;
+    if (submitted.overflowed()) {
+      free_.push_back(index);
+      return false;
+    }
+    writes_[index] = { offset_, 0, submitted.size() };
+    offset_ += submitted.size();
+    if (WriteBackend::io_uring == backend_) {
+      ++in_flight_;
+      queue_write(index);
+    } else {
+      write_now(index);
+      free_.push_back(index);
+    }
+    return true;
+  }
+
+  // Queues a data sync after the writes submitted so far, without waiting
+  // for it.
+  void sync()
+  {
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+    if (WriteBackend::io_uring == backend_) {
+      io_uring_sqe* sqe = next_sqe();
+      sqe->opcode = IORING_OP_FSYNC;
+      sqe->flags = IOSQE_IO_DRAIN;
+      sqe->fd = fd_;
+      sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      sqe->user_data = sync_tag;
+      ++in_flight_;
+      return;
+    }
+#endif
+    sync_now();
+  }
+
+  // Waits for everything queued to complete.
+  bool flush()
+  {
+    progress(false);
+    while (0 < in_flight_) {
+      progress(true);
+    }
+    return StreamState::ok == state_;
+  }
+
+private:
+  struct Write
+  {
+    uint64_t offset;
+    size_t done;
+    size_t size;
+  };
+
+  static constexpr uint64_t sync_tag = std::numeric_limits<uint64_t>::max();
+
+  void sync_now()
+  {
+    if (0 != ::fdatasync(fd_)) {
+      state_ = StreamState::error;
+    }
+  }
+
+  void write_now(size_t index)
+  {
+    Write& write = writes_[index];
+    uint8_t const* data = storage_.data() + index * buffer_size_;
+    while (write.done < write.size) {
+      const ssize_t written = ::pwrite(fd_,
+                                       data + write.done,
+                                       write.size - write.done,
+                                       static_cast<off_t>(write.offset +
+                                                          write.done));
+      if (0 < written) {
+        write.done += static_cast<size_t>(written);
+      } else if ((0 == written) || (EINTR != errno)) {
+        state_ = StreamState::error;
+        return;
+      }
+    }
+  }
+
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+  io_uring_sqe* next_sqe()
+  {
+    io_uring_sqe* sqe = ring_.next();
+    while (nullptr == sqe) {
+      progress(true);
+      sqe = ring_.next();
+    }
+    return sqe;
+  }
+
+  void queue_write(size_t index)
+  {
+    Write& write = writes_[index];
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = fixed_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd_;
+    sqe->addr = reinterpret_cast<uintptr_t>(storage_.data() +
+                                            index * buffer_size_ + write.done);
+    sqe->len = static_cast<uint32_t>(write.size - write.done);
+    sqe->off = write.offset + write.done;
+    sqe->buf_index = fixed_ ? static_cast<uint16_t>(index) : 0;
+    sqe->user_data = index;
+  }
+
+  void complete(uint64_t tag, int result)
+  {
+    if (sync_tag == tag) {
+      --in_flight_;
+      if (result < 0) {
+        state_ = StreamState::error;
+      }
+      return;
+    }
+    const size_t index = static_cast<size_t>(tag);
+    Write& write = writes_[index];
+    if (0 < result) {
+      write.done += static_cast<size_t>(result);
+    } else if (-EINTR != result && -EAGAIN != result) {
+      state_ = StreamState::error;
+      write.done = write.size;
+    }
+    if (write.done < write.size) {
+      queue_write(index);
+    } else {
+      --in_flight_;
+      free_.push_back(index);
+    }
+  }
+
+  // Completes an entry that the kernel did not take with the blocking calls.
+  void fall_back(uint64_t tag)
+  {
+    --in_flight_;
+    if (sync_tag == tag) {
+      sync_now();
+      return;
+    }
+    const size_t index = static_cast<size_t>(tag);
+    write_now(index);
+    free_.push_back(index);
+  }
+#else
+  void queue_write(size_t) {}
+#endif
+
+  // Submits the queued work and recycles the completed buffers. When the
+  // ring refuses the submission, the entries it did not take are written with
+  // pwrite instead, which only fails the writer if pwrite fails too, while
+  // the buffers it holds are only recycled as their completions arrive.
+  void progress(bool wait)
+  {
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+    if (WriteBackend::io_uring == backend_) {
+      if (!ring_.enter(wait ? 1 : 0)) {
+        ring_.retract([this](uint64_t tag) { fall_back(tag); });
+        if (wait) {
+          // Completions are posted on the way back from any system call.
+          ::sched_yield();
+        }
+      }
+      ring_.reap(
+        [this](uint64_t tag, int result) { complete(tag, result); });
+    }
+#else
+    (void)wait;
+#endif
+  }
+
+  int fd_;
+  size_t buffer_size_;
+  uint64_t offset_;
+  std::vector<uint8_t, AlignedAllocator<uint8_t, 4096>> storage_;
+  std::vector<Write> writes_;
+  std::vector<size_t> free_;
+  size_t in_flight_ = 0;
+  StreamState state_ = StreamState::ok;
+  WriteBackend backend_ = WriteBackend::pwrite;
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+  bool fixed_ = false;
+  detail::Ring ring_;
+#endif
+};
+
+template<Endian E>
+using AsyncWriterStreamEndian = Stream<E, AsyncWriteBuffer>;
+using AsyncWriterStream = AsyncWriterStreamEndian<Endian::native>;
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_ASYNC_WRITER_HPP_
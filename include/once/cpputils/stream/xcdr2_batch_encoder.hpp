@@ -0,0 +1,183 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_BATCH_ENCODER_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_BATCH_ENCODER_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Encodes batches of independent messages on a pool of threads, the calling
+// one included. Threads claim small runs of messages and encode each one
+// into its own result buffer, so results come out in submission order with
+// no lock on the output. Result buffers are reused from one batch to the
+// next, so a steady workload does not allocate. If encoding a message
+// throws, the rest of the batch is still encoded and encode() rethrows the
+// first exception once every thread is done with the batch.
+class BatchEncoder
+{
+public:
+  explicit BatchEncoder(size_t thread_count = default_thread_count())
+  {
+    for (size_t i = 1; i < thread_count; ++i) {
+      workers_.emplace_back([this]() { run(); });
+    }
+  }
+
+  BatchEncoder(BatchEncoder const&) = delete;
+  BatchEncoder& operator=(BatchEncoder const&) = delete;
+
+  ~BatchEncoder()
+  {
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto&& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  size_t thread_count() const { return workers_.size() + 1; }
+
+  template<Endian E = Endian::native, typename T>
+  void encode(std::vector<T> const& messages,
+              std::vector<std::vector<uint8_t>>& results)
+  {
+    encode<E>(messages.data(), messages.size(), results);
+  }
+
+  template<Endian E = Endian::native, typename T>
+  void encode(T const* messages,
+              size_t count,
+              std::vector<std::vector<uint8_t>>& results)
+  {
+    results.resize(count);
+    run_batch(count, [messages, &results](size_t index) {
+      results[index].clear();
+      Stream<E, std::vector<uint8_t>> stream{ std::move(results[index]) };
+      stream << messages[index];
+      results[index] = stream.release();
+    });
+  }
+
+private:
+  // Messages claimed at once, few enough to balance uneven sizes.
+  static constexpr size_t run_length = 16;
+
+  static size_t default_thread_count()
+  {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  void run_batch(size_t count, std::function<void(size_t)> const& job)
+  {
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      job_ = &job;
+      count_ = count;
+      next_.store(0, std::memory_order_relaxed);
+      busy_ = workers_.size();
+      ++generation_;
+    }
+    wake_.notify_all();
+    work();
+    std::exception_ptr error;
+    {
+      std::unique_lock<std::mutex> lock{ mutex_ };
+      done_.wait(lock, [this]() { return 0 == busy_; });
+      job_ = nullptr;
+      std::swap(error, error_);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  void work()
+  {
+    for (;;) {
+      const size_t begin =
+        next_.fetch_add(run_length, std::memory_order_relaxed);
+      if (count_ <= begin) {
+        return;
+      }
+      const size_t end = std::min(count_, begin + run_length);
+      for (size_t index = begin; index < end; ++index) {
+        try {
+          (*job_)(index);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock{ mutex_ };
+          if (!error_) {
+            error_ = std::current_exception();
+          }
+        }
+      }
+    }
+  }
+
+  void run()
+  {
+    size_t generation = 0;
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    for (;;) {
+      wake_.wait(lock,
+                 [&]() { return stop_ || (generation != generation_); });
+      if (stop_) {
+        return;
+      }
+      generation = generation_;
+      lock.unlock();
+      work();
+      lock.lock();
+      if (0 == --busy_) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::function<void(size_t)> const* job_ = nullptr;
+  std::exception_ptr error_;
+  size_t count_ = 0;
+  std::atomic<size_t> next_{ 0 };
+  size_t busy_ = 0;
+  size_t generation_ = 0;
+  bool stop_ = false;
+};
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_BATCH_ENCODER_HPP_
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_BUFFER_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_BUFFER_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Allocator adaptor that default-initializes the elements a container
+// constructs without arguments. For trivial types, such as bytes, resize()
+// then grows the container without writing the new elements.
+template<typename T, typename A = std::allocator<T>>
+class DefaultInitAllocator : public A
+{
+  using traits = std::allocator_traits<A>;
+
+public:
+  template<typename U>
+  struct rebind
+  {
+    using other =
+      DefaultInitAllocator<U, typename traits::template rebind_alloc<U>>;
+  };
+
+  using A::A;
+
+  DefaultInitAllocator() = default;
+
+  template<typename U, typename B>
+  DefaultInitAllocator(DefaultInitAllocator<U, B> const& other) noexcept
+    : A(static_cast<B const&>(other))
+  {
+  }
+
+  template<typename U>
+  void construct(U* ptr) noexcept(std::is_nothrow_default_constructible_v<U>)
+  {
+    ::new (static_cast<void*>(ptr)) U;
+  }
+
+  template<typename U, typename... Args>
+  void construct(U* ptr, Args&&... args)
+  {
+    traits::construct(
+      static_cast<A&>(*this), ptr, std::forward<Args>(args)...);
+  }
+};
+
+// Byte buffer whose resize() leaves the new bytes uninitialized, so data
+// received straight into it, e.g. through recv(), is written only once.
+using Buffer = std::vector<uint8_t, DefaultInitAllocator<uint8_t>>;
+
+template<Endian E>
+using BufferStreamEndian = Stream<E, Buffer>;
+using BufferStream = BufferStreamEndian<Endian::native>;
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_BUFFER_HPP_
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_CAPTURE_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_CAPTURE_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Encoded message recorded with when it was seen and which type it has.
+struct CaptureRecord
+{
+  uint64_t timestamp; // Nanoseconds.
+  uint32_t type;
+  Endian endian;
+  std::vector<uint8_t> payload;
+};
+
+// A capture is itself little endian XCDR2: a magic number, a version and
+// the records, each one as its timestamp, type, payload endianness (0 for
+// little, 1 for big) and payload bytes.
+inline constexpr uint32_t capture_magic = 0x50414358; // "XCAP"
+inline constexpr uint32_t capture_version = 1;
+
+inline std::vector<uint8_t>
+encode_capture(std::vector<CaptureRecord> const& records)
+{
+  VectorStreamEndian<Endian::little> stream{};
+  stream << capture_magic << capture_version
+         << static_cast<uint32_t>(records.size());
+  for (auto&& record : records) {
+    stream << record.timestamp << record.type
+           << static_cast<uint8_t>(Endian::little == record.endian ? 0 : 1)
+           << record.payload;
+  }
+  return stream.release();
+}
+
+inline bool
+decode_capture(std::vector<uint8_t> bytes, std::vector<CaptureRecord>& records)
+{
+  VectorStreamEndian<Endian::little> stream{ std::move(bytes) };
+  uint32_t magic{};
+  uint32_t version{};
+  uint32_t count{};
+  stream >> magic >> version >> count;
+  if ((StreamState::ok != stream.deser_state()) || (capture_magic != magic) ||
+      (capture_version != version)) {
+    return false;
+  }
+  records.clear();
+  for (uint32_t i = 0; (i < count) && (StreamState::ok == stream.deser_state());
+       ++i) {
+    CaptureRecord record{};
+    uint8_t endian{};
+    stream >> record.timestamp >> record.type >> endian >> record.payload;
+    if (1 < endian) {
+      stream.set_deser_error();
+    }
+    // A truncated record fails the stream and is not kept.
+    if (StreamState::ok == stream.deser_state()) {
+      record.endian = (0 == endian) ? Endian::little : Endian::big;
+      records.push_back(std::move(record));
+    }
+  }
+  return StreamState::ok == stream.deser_state();
+}
+
+inline bool
+save_capture(std::string const& path, std::vector<CaptureRecord> const& records)
+{
+  const std::vector<uint8_t> bytes = encode_capture(records);
+  std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+  file.write(reinterpret_cast<char const*>(bytes.data()),
+             static_cast<std::streamsize>(bytes.size()));
+  return static_cast<bool>(file);
+}
+
+inline bool
+load_capture(std::string const& path, std::vector<CaptureRecord>& records)
+{
+  std::ifstream file{ path, std::ios::binary };
+  if (!file) {
+    return false;
+  }
+  std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>() };
+  return decode_capture(std::move(bytes), records);
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_CAPTURE_HPP_
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_DELTA_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_DELTA_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Delta between two versions of the same members, usually tied with
+// std::tie(). It is encoded as a bitmap of the changed members, in uint32
+// words, followed by the changed members alone. The receiver shall patch the
+// same version the sender took as reference, with the members tied in the
+// same order, as nothing in the encoding identifies either.
+template<typename Current, typename Reference>
+struct Delta
+{
+  Current current;
+  Reference reference;
+};
+
+template<typename... Ts, typename... Us>
+Delta<std::tuple<Ts&...>, std::tuple<Us&...>>
+delta(std::tuple<Ts&...> current, std::tuple<Us&...> reference)
+{
+  static_assert(sizeof...(Ts) == sizeof...(Us),
+                "both versions shall have the same members");
+  return { current, reference };
+}
+
+// Applies a delta onto the members of an existing object.
+template<typename Target>
+struct Patch
+{
+  Target target;
+};
+
+template<typename... Ts>
+Patch<std::tuple<Ts&...>>
+patch(std::tuple<Ts&...> target)
+{
+  return { target };
+}
+
+namespace detail {
+
+template<size_t N>
+using DeltaBitmap = std::array<uint32_t, (N + 31) / 32>;
+
+template<typename Bitmap>
+bool
+changed(Bitmap const& bitmap, size_t index)
+{
+  return 0 != (bitmap[index / 32] & (uint32_t{ 1 } << (index % 32)));
+}
+
+template<typename Current, typename Reference, size_t... I>
+DeltaBitmap<sizeof...(I)>
+changed_members(Current const& current,
+                Reference const& reference,
+                std::index_sequence<I...>)
+{
+  DeltaBitmap<sizeof...(I)> bitmap{};
+  ((bitmap[I / 32] |= (std::get<I>(current) == std::get<I>(reference))
+                        ? 0
+                        : (uint32_t{ 1 } << (I % 32))),
+   ...);
+  return bitmap;
+}
+
+template<typename S, typename Bitmap, typename Members, size_t... I>
+void
+ser_changed(S& stream,
+            Bitmap const& bitmap,
+            Members const& members,
+            std::index_sequence<I...>)
+{
+  ((changed(bitmap, I) ? (void)(stream << std::get<I>(members)) : (void)0),
+   ...);
+}
+
+template<typename S, typename Bitmap, typename Members, size_t... I>
+void
+deser_changed(S& stream,
+              Bitmap const& bitmap,
+              Members const& members,
+              std::index_sequence<I...>)
+{
+  ((changed(bitmap, I) ? (void)(stream >> std::get<I>(members)) : (void)0),
+   ...);
+}
+
+} // namespace detail
+
+template<Endian E, typename B, typename Current, typename Reference>
+Stream<E, B>&
+operator<<(Stream<E, B>& stream, Delta<Current, Reference> const& delta)
+{
+  using indices = std::make_index_sequence<std::tuple_size<Current>::value>;
+  const auto bitmap =
+    detail::changed_members(delta.current, delta.reference, indices{});
+  stream << bitmap;
+  detail::ser_changed(stream, bitmap, delta.current, indices{});
+  return stream;
+}
+
+template<Endian E, typename B, typename Target>
+Stream<E, B>&
+operator>>(Stream<E, B>& stream, Patch<Target> const& patch)
+{
+  using indices = std::make_index_sequence<std::tuple_size<Target>::value>;
+  detail::DeltaBitmap<std::tuple_size<Target>::value> bitmap{};
+  stream >> bitmap;
+  if (StreamState::ok == stream.deser_state()) {
+    detail::deser_changed(stream, bitmap, patch.target, indices{});
+  }
+  return stream;
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_DELTA_HPP_
@@ -0,0 +1,433 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_DYNAMIC_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_DYNAMIC_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+namespace dynamic {
+
+enum class TypeKind : uint8_t
+{
+  primitive,
+  string,
+  sequence,
+  structure
+};
+
+// Access to a sequence living in a memory image. The elements shall be stored
+// contiguously, one every element size bytes.
+struct SequenceOps
+{
+  size_t footprint;
+  size_t (*size)(void const* sequence);
+  void const* (*data)(void const* sequence);
+  void* (*resize)(void* sequence, size_t size);
+};
+
+template<typename T>
+SequenceOps
+vector_ops()
+{
+  return SequenceOps{
+    sizeof(std::vector<T>),
+    [](void const* sequence) {
+      return static_cast<std::vector<T> const*>(sequence)->size();
+    },
+    [](void const* sequence) {
+      return static_cast<void const*>(
+        static_cast<std::vector<T> const*>(sequence)->data());
+    },
+    [](void* sequence, size_t size) {
+      auto vector = static_cast<std::vector<T>*>(sequence);
+      vector->resize(size);
+      return static_cast<void*>(vector->data());
+    }
+  };
+}
+
+struct Member;
+
+// Largest primitive a plan swaps in place.
+constexpr size_t max_primitive_size = sizeof(uint64_t);
+
+class TypeDescriptor
+{
+public:
+  // Throws std::invalid_argument unless size is 1, 2, 4 or 8.
+  static TypeDescriptor primitive(size_t size);
+
+  template<typename T>
+  static TypeDescriptor primitive()
+  {
+    static_assert(std::is_arithmetic_v<T>);
+    static_assert(sizeof(T) <= max_primitive_size);
+    return primitive(sizeof(T));
+  }
+
+  static TypeDescriptor string();
+
+  static TypeDescriptor sequence(TypeDescriptor element, SequenceOps ops);
+
+  static TypeDescriptor structure(size_t size, std::vector<Member> members);
+
+  TypeKind kind() const { return kind_; }
+
+  // Size of the type in the memory image.
+  size_t size() const { return size_; }
+
+  std::vector<Member> const& members() const { return members_; }
+
+  TypeDescriptor const& element() const { return *element_; }
+
+  SequenceOps const& ops() const { return ops_; }
+
+private:
+  TypeDescriptor(TypeKind kind, size_t size)
+    : kind_{ kind }
+    , size_{ size }
+  {
+  }
+
+  TypeKind kind_;
+  size_t size_;
+  std::vector<Member> members_;
+  std::shared_ptr<TypeDescriptor const> element_;
+  SequenceOps ops_{};
+};
+
+struct Member
+{
+  size_t offset;
+  TypeDescriptor type;
+};
+
+inline TypeDescriptor
+TypeDescriptor::primitive(size_t size)
+{
+  if ((1 != size) && (2 != size) && (4 != size) && (8 != size)) {
+    throw std::invalid_argument{ "primitive size shall be 1, 2, 4 or 8" };
+  }
+  return TypeDescriptor{ TypeKind::primitive, size };
+}
+
+inline TypeDescriptor
+TypeDescriptor::string()
+{
+  return TypeDescriptor{ TypeKind::string, sizeof(std::string) };
+}
+
+inline TypeDescriptor
+TypeDescriptor::sequence(TypeDescriptor element, SequenceOps ops)
+{
+  TypeDescriptor descriptor{ TypeKind::sequence, ops.footprint };
+  descriptor.element_ =
+    std::make_shared<TypeDescriptor const>(std::move(element));
+  descriptor.ops_ = ops;
+  return descriptor;
+}
+
+inline TypeDescriptor
+TypeDescriptor::structure(size_t size, std::vector<Member> members)
+{
+  TypeDescriptor descriptor{ TypeKind::structure, size };
+  descriptor.members_ = std::move(members);
+  return descriptor;
+}
+
+enum class OpCode : uint8_t
+{
+  copy,
+  swap,
+  string,
+  sequence
+};
+
+// For copy and swap, size is the number of bytes of the run. For sequence,
+// size is the element size and body the number of instructions that follow
+// it and encode one element.
+struct Instruction
+{
+  OpCode code;
+  size_t offset;
+  size_t size;
+  size_t alignment;
+  size_t body;
+  bool bulk;
+  SequenceOps const* ops;
+};
+
+template<Endian E>
+class Plan
+{
+public:
+  explicit Plan(TypeDescriptor const& type)
+    : type_{ std::make_shared<TypeDescriptor const>(type) }
+  {
+    compile(*type_, 0);
+  }
+
+  std::vector<Instruction> const& instructions() const
+  {
+    return instructions_;
+  }
+
+private:
+  static size_t alignment(size_t size) { return std::min<size_t>(size, 4); }
+
+  void compile(TypeDescriptor const& type, size_t offset)
+  {
+    switch (type.kind()) {
+      case TypeKind::primitive:
+        compile_primitive(offset, type.size());
+        break;
+      case TypeKind::string:
+        instructions_.push_back(
+          { OpCode::string, offset, 0, 4, 0, false, nullptr });
+        run_ = npos;
+        break;
+      case TypeKind::sequence:
+        compile_sequence(type, offset);
+        break;
+      case TypeKind::structure:
+        for (auto&& member : type.members()) {
+          compile(member.type, offset + member.offset);
+        }
+        break;
+    }
+  }
+
+  void compile_primitive(size_t offset, size_t size)
+  {
+    const size_t align = alignment(size);
+    if constexpr (E == Endian::native) {
+      // Fuse with the open run when neither the memory image nor the stream
+      // would put padding in between.
+      if (npos != run_) {
+        Instruction& run = instructions_[run_];
+        if ((run.offset + run.size == offset) && (align <= run.alignment) &&
+            (0 == run.size % align)) {
+          run.size += size;
+          return;
+        }
+      }
+      run_ = instructions_.size();
+      instructions_.push_back(
+        { OpCode::copy, offset, size, align, 0, false, nullptr });
+    } else {
+      instructions_.push_back(
+        { OpCode::swap, offset, size, align, 0, false, nullptr });
+    }
+  }
+
+  void compile_sequence(TypeDescriptor const& type, size_t offset)
+  {
+    const size_t index = instructions_.size();
+    instructions_.push_back({ OpCode::sequence,
+                              offset,
+                              type.element().size(),
+                              4,
+                              0,
+                              false,
+                              &type.ops() });
+    run_ = npos;
+    compile(type.element(), 0);
+    run_ = npos;
+
+    Instruction& sequence = instructions_[index];
+    sequence.body = instructions_.size() - index - 1;
+    // Elements are copied as a whole when neither the memory image nor the
+    // stream puts padding between them.
+    if (1 == sequence.body) {
+      Instruction const& element = instructions_[index + 1];
+      sequence.bulk = (OpCode::copy == element.code) &&
+                      (0 == element.offset) &&
+                      (sequence.size == element.size) &&
+                      (0 == element.size % element.alignment);
+    }
+  }
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  std::shared_ptr<TypeDescriptor const> type_;
+  std::vector<Instruction> instructions_;
+  size_t run_ = npos;
+};
+
+namespace detail {
+
+template<Endian E, typename B>
+void
+serialize(Stream<E, B>& stream,
+          Instruction const* first,
+          Instruction const* last,
+          uint8_t const* image)
+{
+  while (first != last) {
+    Instruction const& instruction = *first++;
+    uint8_t const* data = image + instruction.offset;
+    switch (instruction.code) {
+      case OpCode::copy:
+        stream.write(data, instruction.size, instruction.alignment);
+        break;
+      case OpCode::swap: {
+        uint8_t swapped[max_primitive_size];
+        std::reverse_copy(data, data + instruction.size, swapped);
+        stream.write(swapped, instruction.size, instruction.alignment);
+        break;
+      }
+      case OpCode::string:
+        stream << *static_cast<std::string const*>(
+          static_cast<void const*>(data));
+        break;
+      case OpCode::sequence: {
+        const uint32_t length = instruction.ops->size(data);
+        auto elements =
+          static_cast<uint8_t const*>(instruction.ops->data(data));
+        stream << length;
+        if (instruction.bulk) {
+          if (0 < length) {
+            Instruction const& element = *first;
+            stream.write(
+              elements, length * instruction.size, element.alignment);
+          }
+        } else {
+          for (uint32_t i = 0; i < length; ++i) {
+            serialize(stream,
+                      first,
+                      first + instruction.body,
+                      elements + i * instruction.size);
+          }
+        }
+        first += instruction.body;
+        break;
+      }
+    }
+  }
+}
+
+template<Endian E, typename B>
+void
+deserialize(Stream<E, B>& stream,
+            Instruction const* first,
+            Instruction const* last,
+            uint8_t* image)
+{
+  while (first != last) {
+    if (StreamState::ok != stream.deser_state()) {
+      return;
+    }
+    Instruction const& instruction = *first++;
+    uint8_t* data = image + instruction.offset;
+    switch (instruction.code) {
+      case OpCode::copy:
+        stream.read(data, instruction.size, instruction.alignment);
+        break;
+      case OpCode::swap: {
+        uint8_t swapped[max_primitive_size];
+        stream.read(swapped, instruction.size, instruction.alignment);
+        std::reverse_copy(swapped, swapped + instruction.size, data);
+        break;
+      }
+      case OpCode::string:
+        stream >> *static_cast<std::string*>(static_cast<void*>(data));
+        break;
+      case OpCode::sequence: {
+        uint32_t length{};
+        stream >> length;
+        if (StreamState::ok != stream.deser_state()) {
+          return;
+        }
+        auto&& ops = *instruction.ops;
+        if (instruction.bulk) {
+          // Checked before resizing, so that a corrupt length does not
+          // allocate.
+          if (length * instruction.size > stream.deser_remaining()) {
+            stream.set_deser_error();
+            return;
+          }
+          auto elements = static_cast<uint8_t*>(ops.resize(data, length));
+          if (0 < length) {
+            Instruction const& element = *first;
+            stream.read(elements, length * instruction.size, element.alignment);
+          }
+        } else {
+          // Grown while decoding, as the elements' encoded size is unknown.
+          uint32_t i = 0;
+          for (; (i < length) && (StreamState::ok == stream.deser_state());
+               ++i) {
+            if (ops.size(data) == i) {
+              ops.resize(data, i + 1);
+            }
+            auto elements =
+              static_cast<uint8_t*>(const_cast<void*>(ops.data(data)));
+            deserialize(stream,
+                        first,
+                        first + instruction.body,
+                        elements + i * instruction.size);
+          }
+          ops.resize(data, i);
+        }
+        first += instruction.body;
+        break;
+      }
+    }
+  }
+}
+
+} // namespace detail
+
+template<Endian E, typename B>
+Stream<E, B>&
+serialize(Stream<E, B>& stream, Plan<E> const& plan, void const* image)
+{
+  auto&& instructions = plan.instructions();
+  detail::serialize(stream,
+                    instructions.data(),
+                    instructions.data() + instructions.size(),
+                    static_cast<uint8_t const*>(image));
+  return stream;
+}
+
+template<Endian E, typename B>
+Stream<E, B>&
+deserialize(Stream<E, B>& stream, Plan<E> const& plan, void* image)
+{
+  auto&& instructions = plan.instructions();
+  detail::deserialize(stream,
+                      instructions.data(),
+                      instructions.data() + instructions.size(),
+                      static_cast<uint8_t*>(image));
+  return stream;
+}
+
+} // namespace dynamic
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_DYNAMIC_HPP_
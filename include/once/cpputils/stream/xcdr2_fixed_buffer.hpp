@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_FIXED_BUFFER_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_FIXED_BUFFER_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Fixed-capacity storage owned by someone else, such as a shared-memory slot
+// or a registered I/O buffer. Writing past its capacity drops the data and
+// marks it as overflowed.
+class FixedBuffer
+{
+public:
+  FixedBuffer() = default;
+
+  FixedBuffer(uint8_t* data, size_t capacity)
+    : data_{ data }
+    , capacity_{ capacity }
+  {
+  }
+
+  FixedBuffer(FixedBuffer&& other) noexcept { *this = std::move(other); }
+
+  FixedBuffer& operator=(FixedBuffer&& other) noexcept
+  {
+    data_ = std::exchange(other.data_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+    size_ = std::exchange(other.size_, 0);
+    overflowed_ = std::exchange(other.overflowed_, false);
+    return *this;
+  }
+
+  bool valid() const { return nullptr != data_; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool overflowed() const { return overflowed_; }
+  uint8_t const* data() const { return data_; }
+
+  // Room for size more bytes, or nullptr if they do not fit.
+  uint8_t* grow(size_t size)
+  {
+    if (overflowed_ || (capacity_ - size_ < size)) {
+      overflowed_ = true;
+      return nullptr;
+    }
+    uint8_t* ptr = data_ + size_;
+    size_ += size;
+    return ptr;
+  }
+
+private:
+  uint8_t* data_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  bool overflowed_ = false;
+};
+
+template<>
+struct BufferTraits<FixedBuffer>
+{
+  using buffer_type = FixedBuffer;
+
+  static size_t size(buffer_type const& buffer) { return buffer.size(); }
+
+  static void append(buffer_type& buffer, uint8_t const* data, size_t size)
+  {
+    if (uint8_t* ptr = buffer.grow(size)) {
+      std::memcpy(ptr, data, size);
+    }
+  }
+
+  static void append_zeros(buffer_type& buffer, size_t size)
+  {
+    if (uint8_t* ptr = buffer.grow(size)) {
+      std::memset(ptr, 0, size);
+    }
+  }
+
+  static void copy(buffer_type const& buffer,
+                   size_t position,
+                   uint8_t* data,
+                   size_t size)
+  {
+    std::memcpy(data, buffer.data() + position, size);
+  }
+
+  static uint8_t const* contiguous(buffer_type const& buffer,
+                                   size_t position,
+                                   size_t /* size */)
+  {
+    return buffer.data() + position;
+  }
+
+  template<typename F>
+  static void for_each_chunk(buffer_type const& buffer,
+                             size_t position,
+                             size_t size,
+                             F&& function)
+  {
+    function(buffer.data() + position, size);
+  }
+};
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_FIXED_BUFFER_HPP_
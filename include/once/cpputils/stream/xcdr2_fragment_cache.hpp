@@ -0,0 +1,122 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_FRAGMENT_CACHE_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_FRAGMENT_CACHE_HPP_
+
+#include <once/cpputils/reference/reference.hpp>
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <any>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+class FragmentCache;
+
+template<typename T>
+struct Fragment
+{
+  FragmentCache& cache;
+  reference<T> const& value;
+};
+
+// Encoded bytes of immutable sub-objects, keyed by the identity of their
+// target. As padding depends on where a fragment starts, bytes are kept for
+// each endianness and alignment phase they are spliced at. The cache holds a
+// reference to every target, so that no other object takes its identity.
+// Targets are not compared with their cached bytes: a target changed through
+// its reference keeps being spliced as it was until it is erased, so callers
+// shall erase() a target whenever they change it. Key-only streams and
+// streams in graph mode bypass the cache, as their bytes depend on the key
+// members of the enclosing type and on the targets met before.
+class FragmentCache
+{
+public:
+  template<typename T>
+  Fragment<T> fragment(reference<T> const& value)
+  {
+    return Fragment<T>{ *this, value };
+  }
+
+  // Drops the bytes of a target, to be encoded again on its next use.
+  template<typename T>
+  void erase(reference<T> const& value)
+  {
+    entries_.erase(&*value);
+  }
+
+  void clear() { entries_.clear(); }
+
+  // Cached targets.
+  size_t size() const { return entries_.size(); }
+
+  template<Endian E, typename T>
+  std::vector<uint8_t> const& bytes(reference<T> const& value, size_t phase)
+  {
+    Entry& entry = entries_[&*value];
+    if (!entry.owner.has_value()) {
+      entry.owner = value;
+    }
+    const size_t slot = (Endian::little == E ? 0 : phases) + phase % phases;
+    if (!entry.cached[slot]) {
+      Stream<E, std::vector<uint8_t>> stream{};
+      stream.write(zeros.data(), phase % phases);
+      stream << *value;
+      std::vector<uint8_t> encoded = stream.release();
+      entry.bytes[slot].assign(encoded.begin() + phase % phases,
+                               encoded.end());
+      entry.cached[slot] = true;
+    }
+    return entry.bytes[slot];
+  }
+
+private:
+  // XCDR2 aligns nothing beyond 4 bytes, so the phase modulo 4 suffices.
+  static constexpr size_t phases = 4;
+  static constexpr std::array<uint8_t, phases> zeros{};
+
+  struct Entry
+  {
+    std::any owner;
+    std::array<std::vector<uint8_t>, 2 * phases> bytes;
+    std::array<bool, 2 * phases> cached{};
+  };
+
+  std::unordered_map<void const*, Entry> entries_;
+};
+
+template<Endian E, typename B, typename T>
+Stream<E, B>&
+operator<<(Stream<E, B>& stream, Fragment<T> const& data)
+{
+  if (stream.key_only() || (nullptr != stream.graph())) {
+    return stream << *data.value;
+  }
+  auto&& bytes =
+    data.cache.template bytes<E>(data.value, stream.ser_length());
+  return stream.write(bytes.data(), bytes.size());
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_FRAGMENT_CACHE_HPP_
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_GRAPH_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_GRAPH_HPP_
+
+#include <once/cpputils/reference/reference.hpp>
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <any>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Shared references met while encoding or decoding one message. In graph
+// mode, a reference is encoded as a uint32 tag: zero followed by its target
+// the first time the target is met, or the 1-based order in which it was
+// first met for every repeat. Decoding rebuilds the sharing. The tags index
+// the targets of the current message alone, so the decoder shall run in
+// graph mode as well, with a graph cleared at the same message boundaries.
+class Graph
+{
+  template<Endian E, typename B, typename T>
+  friend Stream<E, B>& operator<<(Stream<E, B>& stream,
+                                  reference<T> const& data);
+
+  template<Endian E, typename B, typename T>
+  friend Stream<E, B>& operator>>(Stream<E, B>& stream, reference<T>& data);
+
+public:
+  // Forgets every target, before a new message.
+  void clear()
+  {
+    ids_.clear();
+    targets_.clear();
+  }
+
+  // Distinct targets met so far.
+  size_t size() const { return ids_.size() + targets_.size(); }
+
+private:
+  std::unordered_map<void const*, uint32_t> ids_;
+  std::vector<std::any> targets_;
+};
+
+// Without a graph, the target is encoded every time.
+template<Endian E, typename B, typename T>
+Stream<E, B>&
+operator<<(Stream<E, B>& stream, reference<T> const& data)
+{
+  Graph* graph = stream.graph();
+  if (nullptr == graph) {
+    return stream << *data;
+  }
+  const auto id = static_cast<uint32_t>(graph->ids_.size() + 1);
+  auto [it, inserted] = graph->ids_.emplace(&*data, id);
+  if (inserted) {
+    stream << uint32_t{ 0 } << *data;
+  } else {
+    stream << it->second;
+  }
+  return stream;
+}
+
+// Decoded targets are always new objects, which the reference then points
+// to.
+template<Endian E, typename B, typename T>
+Stream<E, B>&
+operator>>(Stream<E, B>& stream, reference<T>& data)
+{
+  Graph* graph = stream.graph();
+  if (nullptr == graph) {
+    reference<T> target{};
+    stream >> *target;
+    data = target;
+    return stream;
+  }
+  uint32_t id{};
+  stream >> id;
+  if (StreamState::ok != stream.deser_state()) {
+    return stream;
+  }
+  if (0 == id) {
+    reference<T> target{};
+    graph->targets_.emplace_back(target);
+    data = target;
+    stream >> *data;
+  } else if (id <= graph->targets_.size()) {
+    if (auto target = std::any_cast<reference<T>>(&graph->targets_[id - 1])) {
+      data = *target;
+    } else {
+      stream.set_deser_error();
+    }
+  } else {
+    stream.set_deser_error();
+  }
+  return stream;
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_GRAPH_HPP_
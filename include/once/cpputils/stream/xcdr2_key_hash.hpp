@@ -0,0 +1,122 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_KEY_HASH_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_KEY_HASH_HPP_
+
+#include <once/cpputils/stream/md5.hpp>
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+using KeyHash = std::array<uint8_t, 16>;
+
+enum class KeyHashMode : uint8_t
+{
+  // Zero padded key when it fits in 16 bytes, MD5 otherwise. Key types whose
+  // maximum serialized size exceeds 16 bytes shall use md5 instead, so that
+  // short instances still hash as the specification mandates.
+  fitting,
+  md5
+};
+
+template<typename T>
+std::vector<uint8_t>
+key_bytes(T const& sample)
+{
+  Stream<Endian::big, std::vector<uint8_t>> stream{};
+  stream.set_key_only(true);
+  stream << sample;
+  return stream.buffer();
+}
+
+// Key hash as defined by DDS-XTypes: the key members serialized in big endian
+// XCDR2, strings with their terminating NUL.
+template<typename T>
+KeyHash
+key_hash(T const& sample, KeyHashMode mode = KeyHashMode::fitting)
+{
+  const std::vector<uint8_t> bytes = key_bytes(sample);
+  if ((KeyHashMode::fitting == mode) && (bytes.size() <= sizeof(KeyHash))) {
+    KeyHash hash{};
+    std::copy(bytes.begin(), bytes.end(), hash.begin());
+    return hash;
+  }
+  return md5::compute(bytes.data(), bytes.size());
+}
+
+namespace detail {
+
+inline uint64_t
+mix(uint64_t lhs, uint64_t rhs)
+{
+#ifdef __SIZEOF_INT128__
+  const __uint128_t product = static_cast<__uint128_t>(lhs) * rhs;
+  return static_cast<uint64_t>(product) ^
+         static_cast<uint64_t>(product >> 64);
+#else
+  uint64_t value = (lhs ^ (rhs >> 29)) * rhs;
+  return value ^ (value >> 32);
+#endif
+}
+
+inline uint64_t
+fast_hash(uint8_t const* data, size_t size)
+{
+  constexpr uint64_t seed = 0xa0761d6478bd642full;
+  constexpr uint64_t multiplier = 0xe7037ed1a0b428dbull;
+  uint64_t hash = seed ^ size;
+  while (sizeof(uint64_t) <= size) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    hash = mix(hash ^ word, multiplier);
+    data += sizeof(word);
+    size -= sizeof(word);
+  }
+  if (0 < size) {
+    uint64_t word = 0;
+    std::memcpy(&word, data, size);
+    hash = mix(hash ^ word, multiplier);
+  }
+  return mix(hash ^ multiplier, seed);
+}
+
+} // namespace detail
+
+// Non cryptographic hash of the native endian key members, intended for
+// instance lookup tables. It is not stable across architectures.
+template<typename T>
+uint64_t
+fast_key_hash(T const& sample)
+{
+  VectorStream stream{};
+  stream.set_key_only(true);
+  stream << sample;
+  return detail::fast_hash(stream.buffer().data(), stream.buffer().size());
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_KEY_HASH_HPP_
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_LAZY_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_LAZY_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+#include <once/cpputils/stream/xcdr2_buffer.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Member that stays encoded until it is first accessed. It is serialized as
+// its byte length followed by the encoded T, so deserializing it only copies
+// the bytes, and serializing it again, untouched, only copies them back.
+// Const access and serialization decode and encode under a lock, so they may
+// run concurrently on the same Lazy, as with any other const object.
+// Key-only streams skip it without decoding it. In graph mode it is encoded
+// as a plain T and decoded right away, as the encoding of its shared
+// references depends on the targets met before it.
+template<typename T>
+class Lazy
+{
+  template<Endian E, typename B, typename U>
+  friend Stream<E, B>& operator<<(Stream<E, B>& stream, Lazy<U> const& lazy);
+
+  template<Endian E, typename B, typename U>
+  friend Stream<E, B>& operator>>(Stream<E, B>& stream, Lazy<U>& lazy);
+
+public:
+  Lazy() = default;
+
+  Lazy(T value)
+    : value_{ std::move(value) }
+    , materialized_{ true }
+  {
+  }
+
+  Lazy(Lazy const& other) { *this = other; }
+
+  Lazy(Lazy&& other) { *this = std::move(other); }
+
+  Lazy& operator=(Lazy const& other)
+  {
+    if (this != &other) {
+      std::lock_guard<std::mutex> lock{ other.mutex_ };
+      value_ = other.value_;
+      bytes_ = other.bytes_;
+      endian_ = other.endian_;
+      encoded_ = other.encoded_;
+      deser_state_ = other.deser_state_;
+      materialized_.store(other.materialized_.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  Lazy& operator=(Lazy&& other)
+  {
+    if (this != &other) {
+      value_ = std::move(other.value_);
+      bytes_ = std::move(other.bytes_);
+      endian_ = other.endian_;
+      encoded_ = other.encoded_;
+      deser_state_ = other.deser_state_;
+      materialized_.store(other.materialized_.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  Lazy& operator=(T value)
+  {
+    value_ = std::move(value);
+    materialized_.store(true, std::memory_order_relaxed);
+    encoded_ = false;
+    return *this;
+  }
+
+  bool materialized() const
+  {
+    return materialized_.load(std::memory_order_acquire);
+  }
+
+  // State of the deserialization that materialized the value.
+  StreamState deser_state() const
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return deser_state_;
+  }
+
+  T const& get() const
+  {
+    materialize();
+    return value_;
+  }
+
+  // Mutable access drops the retained bytes, as the value may change.
+  T& get()
+  {
+    materialize();
+    encoded_ = false;
+    return value_;
+  }
+
+  T const& operator*() const { return get(); }
+  T& operator*() { return get(); }
+  T const* operator->() const { return &get(); }
+  T* operator->() { return &get(); }
+
+private:
+  void materialize() const
+  {
+    if (!materialized_.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      materialize_locked();
+    }
+  }
+
+  void materialize_locked() const
+  {
+    if (!materialized_.load(std::memory_order_relaxed)) {
+      if (Endian::little == endian_) {
+        decode<Endian::little>();
+      } else {
+        decode<Endian::big>();
+      }
+      materialized_.store(true, std::memory_order_release);
+    }
+  }
+
+  template<Endian E>
+  void decode() const
+  {
+    Stream<E, Buffer> stream{ std::move(bytes_) };
+    stream >> value_;
+    deser_state_ = stream.deser_state();
+    bytes_ = stream.release();
+  }
+
+  // Writes the retained bytes, encoding them first if they are missing or of
+  // the other endianness.
+  template<Endian E, typename B>
+  void encode(Stream<E, B>& stream) const
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (!encoded_ || (E != endian_)) {
+      materialize_locked();
+      Stream<E, Buffer> encoder{};
+      bytes_.clear();
+      encoder.adopt(std::move(bytes_));
+      encoder << value_;
+      bytes_ = encoder.release();
+      endian_ = E;
+      encoded_ = true;
+    }
+    stream << static_cast<uint32_t>(bytes_.size());
+    stream.write(bytes_.data(), bytes_.size());
+  }
+
+  mutable T value_{};
+  mutable Buffer bytes_;
+  mutable Endian endian_ = Endian::native;
+  mutable std::atomic<bool> materialized_{ true };
+  mutable bool encoded_ = false;
+  mutable StreamState deser_state_ = StreamState::ok;
+  mutable std::mutex mutex_;
+};
+
+template<Endian E, typename B, typename T>
+Stream<E, B>&
+operator<<(Stream<E, B>& stream, Lazy<T> const& lazy)
+{
+  if (stream.skipped()) {
+    return stream;
+  }
+  if (nullptr != stream.graph()) {
+    return stream << lazy.get();
+  }
+  lazy.encode(stream);
+  return stream;
+}
+
+template<Endian E, typename B, typename T>
+Stream<E, B>&
+operator>>(Stream<E, B>& stream, Lazy<T>& lazy)
+{
+  if (nullptr != stream.graph()) {
+    return stream >> lazy.get();
+  }
+  uint32_t length{};
+  stream >> length;
+  if (StreamState::ok != stream.deser_state()) {
+    return stream;
+  }
+  // Checked upfront, so that a corrupt length neither allocates nor alters
+  // the member. The resized bytes are left uninitialized for the read.
+  if (length > stream.deser_remaining()) {
+    stream.set_deser_error();
+    return stream;
+  }
+  lazy.bytes_.resize(length);
+  stream.read(lazy.bytes_.data(), length);
+  lazy.endian_ = E;
+  lazy.encoded_ = true;
+  lazy.materialized_.store(false, std::memory_order_relaxed);
+  return stream;
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_LAZY_HPP_
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_RESULT_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_RESULT_HPP_
+
+#include <once/cpputils/result/result.hpp>
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Offset at which the deserialization stopped: the first read that failed,
+// or the end of the data when only the CRC32C trailer was wrong.
+struct DecodeError
+{
+  size_t position;
+
+  bool operator==(DecodeError const& other) const
+  {
+    return position == other.position;
+  }
+
+  bool operator!=(DecodeError const& other) const { return !(*this == other); }
+};
+
+template<typename T>
+using DecodeResult = result<T, DecodeError>;
+
+// Decodes the next T from the stream. A stream stops reading at its first
+// error, so a malformed message fails without being decoded to its end.
+template<typename T, Endian E, typename B>
+DecodeResult<T>
+decode(Stream<E, B>& stream)
+{
+  T value{};
+  stream >> value;
+  if (StreamState::ok == stream.deser_state()) {
+    return { ok_result, std::move(value) };
+  }
+  return { error_result, DecodeError{ stream.deser_length() } };
+}
+
+// Decodes a whole message, verifying its trailer when there is one.
+template<typename T,
+         Endian E = Endian::native,
+         typename B,
+         typename = std::enable_if_t<!std::is_base_of_v<StreamBase, B>>>
+DecodeResult<T>
+decode(B buffer, Trailer trailer = Trailer::none)
+{
+  Stream<E, B> stream{};
+  stream.set_trailer(trailer);
+  stream.adopt(std::move(buffer));
+  DecodeResult<T> decoded = decode<T>(stream);
+  if (decoded.is_ok() && !stream.verify()) {
+    return { error_result, DecodeError{ stream.deser_length() } };
+  }
+  return decoded;
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_RESULT_HPP_
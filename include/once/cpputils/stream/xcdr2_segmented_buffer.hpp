@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_SEGMENTED_BUFFER_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_SEGMENTED_BUFFER_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#define ONCE__CPPUTILS__XCDR2_IOVEC
+#endif
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Buffer made of fixed-size slabs. Appending never moves the bytes already
+// written, so growing a huge buffer costs no reallocation copies.
+template<size_t SlabSize = 64 * 1024>
+class SegmentedBuffer
+{
+  static_assert((0 < SlabSize) && (0 == (SlabSize & (SlabSize - 1))),
+                "the slab size shall be a power of two");
+
+public:
+  struct Segment
+  {
+    uint8_t const* data;
+    size_t size;
+  };
+
+  static constexpr size_t slab_size = SlabSize;
+
+  size_t size() const { return size_; }
+  bool empty() const { return 0 == size_; }
+  size_t slab_count() const { return slabs_.size(); }
+
+  void append(uint8_t const* data, size_t size)
+  {
+    while (0 < size) {
+      const size_t n = reserve(size);
+      std::memcpy(slabs_.back().get() + offset(size_), data, n);
+      data += n;
+      size -= n;
+      size_ += n;
+    }
+  }
+
+  void append_zeros(size_t size)
+  {
+    while (0 < size) {
+      const size_t n = reserve(size);
+      std::memset(slabs_.back().get() + offset(size_), 0, n);
+      size -= n;
+      size_ += n;
+    }
+  }
+
+  void copy(size_t position, uint8_t* data, size_t size) const
+  {
+    for_each_segment(position, size, [&data](uint8_t const* ptr, size_t n) {
+      std::memcpy(data, ptr, n);
+      data += n;
+    });
+  }
+
+  uint8_t const* contiguous(size_t position, size_t size) const
+  {
+    if (offset(position) + size > SlabSize) {
+      return nullptr;
+    }
+    return slabs_[position / SlabSize].get() + offset(position);
+  }
+
+  template<typename F>
+  void for_each_segment(size_t position, size_t size, F&& function) const
+  {
+    while (0 < size) {
+      const size_t n = std::min(size, SlabSize - offset(position));
+      function(
+        static_cast<uint8_t const*>(slabs_[position / SlabSize].get()) +
+          offset(position),
+        n);
+      position += n;
+      size -= n;
+    }
+  }
+
+  std::vector<Segment> segments() const
+  {
+    std::vector<Segment> segments;
+    segments.reserve(slabs_.size());
+    for_each_segment(0, size_, [&segments](uint8_t const* ptr, size_t n) {
+      segments.push_back({ ptr, n });
+    });
+    return segments;
+  }
+
+#ifdef ONCE__CPPUTILS__XCDR2_IOVEC
+  // Ready for writev() or sendmsg().
+  std::vector<iovec> iovecs() const
+  {
+    std::vector<iovec> iovecs;
+    iovecs.reserve(slabs_.size());
+    for_each_segment(0, size_, [&iovecs](uint8_t const* ptr, size_t n) {
+      iovecs.push_back({ const_cast<uint8_t*>(ptr), n });
+    });
+    return iovecs;
+  }
+#endif
+
+  std::vector<uint8_t> flatten() const
+  {
+    std::vector<uint8_t> flat(size_);
+    copy(0, flat.data(), size_);
+    return flat;
+  }
+
+private:
+  static size_t offset(size_t position) { return position & (SlabSize - 1); }
+
+  // Makes room in the last slab, returning how much of size fits in it.
+  size_t reserve(size_t size)
+  {
+    if (size_ == slabs_.size() * SlabSize) {
+      slabs_.emplace_back(new uint8_t[SlabSize]);
+    }
+    return std::min(size, SlabSize - offset(size_));
+  }
+
+  std::vector<std::unique_ptr<uint8_t[]>> slabs_;
+  size_t size_ = 0;
+};
+
+template<size_t SlabSize>
+struct BufferTraits<SegmentedBuffer<SlabSize>>
+{
+  using buffer_type = SegmentedBuffer<SlabSize>;
+
+  static size_t size(buffer_type const& buffer) { return buffer.size(); }
+
+  static void append(buffer_type& buffer, uint8_t const* data, size_t size)
+  {
+    buffer.append(data, size);
+  }
+
+  static void append_zeros(buffer_type& buffer, size_t size)
+  {
+    buffer.append_zeros(size);
+  }
+
+  static void copy(buffer_type const& buffer,
+                   size_t position,
+                   uint8_t* data,
+                   size_t size)
+  {
+    buffer.copy(position, data, size);
+  }
+
+  static uint8_t const* contiguous(buffer_type const& buffer,
+                                   size_t position,
+                                   size_t size)
+  {
+    return buffer.contiguous(position, size);
+  }
+
+  template<typename F>
+  static void for_each_chunk(buffer_type const& buffer,
+                             size_t position,
+                             size_t size,
+                             F&& function)
+  {
+    buffer.for_each_segment(position, size, std::forward<F>(function));
+  }
+};
+
+template<Endian E, size_t SlabSize = 64 * 1024>
+using SegmentedStreamEndian = Stream<E, SegmentedBuffer<SlabSize>>;
+using SegmentedStream = SegmentedStreamEndian<Endian::native>;
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_SEGMENTED_BUFFER_HPP_
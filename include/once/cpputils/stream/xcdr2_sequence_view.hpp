@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_SEQUENCE_VIEW_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_SEQUENCE_VIEW_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Sequence decoded one element at a time while it is iterated, into a single
+// element object reused from one element to the next. Iterating it is a
+// single pass that consumes the stream, and an element is only valid until
+// the iterator moves on. A stream error ends the iteration early.
+template<typename T, typename S>
+class SequenceView
+{
+public:
+  class iterator
+  {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T const*;
+    using reference = T const&;
+
+    iterator() = default;
+
+    reference operator*() const { return view_->element_; }
+    pointer operator->() const { return &view_->element_; }
+
+    iterator& operator++()
+    {
+      view_->advance();
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(iterator const& other) const
+    {
+      return ended() == other.ended();
+    }
+
+    bool operator!=(iterator const& other) const { return !(*this == other); }
+
+  private:
+    friend class SequenceView;
+
+    explicit iterator(SequenceView* view)
+      : view_{ view }
+    {
+    }
+
+    bool ended() const { return (nullptr == view_) || !view_->current_; }
+
+    SequenceView* view_ = nullptr;
+  };
+
+  SequenceView(S& stream, size_t length)
+    : stream_{ stream }
+    , length_{ length }
+  {
+  }
+
+  SequenceView(SequenceView const&) = delete;
+  SequenceView& operator=(SequenceView const&) = delete;
+
+  size_t size() const { return length_; }
+
+  // Elements decoded so far.
+  size_t position() const { return position_; }
+
+  iterator begin()
+  {
+    if (0 == position_) {
+      advance();
+    }
+    return iterator{ this };
+  }
+
+  iterator end() { return iterator{}; }
+
+  // Decodes and drops the elements not iterated yet, which leaves the stream
+  // right after the sequence.
+  S& finish()
+  {
+    while (position_ < length_ && (StreamState::ok == stream_.deser_state())) {
+      advance();
+    }
+    current_ = false;
+    return stream_;
+  }
+
+private:
+  void advance()
+  {
+    current_ =
+      (position_ < length_) && (StreamState::ok == stream_.deser_state());
+    if (current_) {
+      stream_ >> element_;
+      ++position_;
+      current_ = StreamState::ok == stream_.deser_state();
+    }
+  }
+
+  S& stream_;
+  size_t length_;
+  size_t position_ = 0;
+  bool current_ = false;
+  T element_{};
+};
+
+// Reads the length of a sequence whose elements are then decoded by
+// iterating the view.
+template<typename T, Endian E, typename B>
+SequenceView<T, Stream<E, B>>
+sequence_view(Stream<E, B>& stream)
+{
+  uint32_t length{};
+  stream >> length;
+  return SequenceView<T, Stream<E, B>>{
+    stream, (StreamState::ok == stream.deser_state()) ? length : 0u
+  };
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_SEQUENCE_VIEW_HPP_
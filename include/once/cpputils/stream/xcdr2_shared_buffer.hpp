@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_SHARED_BUFFER_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_SHARED_BUFFER_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Immutable serialized data. Copies share the same bytes, so several threads
+// can decode one received buffer at once, each one through its own Reader
+// with its own position and state.
+class SharedBuffer
+{
+public:
+  SharedBuffer() = default;
+
+  explicit SharedBuffer(std::vector<uint8_t> bytes)
+    : bytes_{ std::make_shared<std::vector<uint8_t> const>(std::move(bytes)) }
+  {
+  }
+
+  size_t size() const { return bytes_ ? bytes_->size() : 0; }
+  bool empty() const { return 0 == size(); }
+  uint8_t const* data() const { return bytes_ ? bytes_->data() : nullptr; }
+
+  // Number of buffers, readers included, sharing the bytes.
+  long use_count() const { return bytes_.use_count(); }
+
+private:
+  std::shared_ptr<std::vector<uint8_t> const> bytes_;
+};
+
+// Read-only: there is no append, so a Reader cannot serialize.
+template<>
+struct BufferTraits<SharedBuffer>
+{
+  using buffer_type = SharedBuffer;
+
+  static size_t size(buffer_type const& buffer) { return buffer.size(); }
+
+  static void copy(buffer_type const& buffer,
+                   size_t position,
+                   uint8_t* data,
+                   size_t size)
+  {
+    std::copy_n(buffer.data() + position, size, data);
+  }
+
+  static uint8_t const* contiguous(buffer_type const& buffer,
+                                   size_t position,
+                                   size_t /* size */)
+  {
+    return buffer.data() + position;
+  }
+
+  template<typename F>
+  static void for_each_chunk(buffer_type const& buffer,
+                             size_t position,
+                             size_t size,
+                             F&& function)
+  {
+    function(buffer.data() + position, size);
+  }
+};
+
+template<Endian E>
+using ReaderEndian = Stream<E, SharedBuffer>;
+using Reader = ReaderEndian<Endian::native>;
+
+// Cursor at the start of the shared data. Borrowed spans stay valid as long
+// as any copy of the buffer is alive.
+template<Endian E = Endian::native>
+ReaderEndian<E>
+reader(SharedBuffer const& buffer)
+{
+  return ReaderEndian<E>{ SharedBuffer{ buffer } };
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_SHARED_BUFFER_HPP_
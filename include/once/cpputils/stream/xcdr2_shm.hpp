@@ -0,0 +1,481 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_SHM_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_SHM_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+#include <once/cpputils/stream/xcdr2_fixed_buffer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <utility>
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ONCE__CPPUTILS__XCDR2_SHM
+#endif
+
+#ifdef ONCE__CPPUTILS__XCDR2_SHM
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Slot of a shared-memory segment being serialized into. An overflowed slot
+// is not published. A slot dropped without being published is freed.
+class ShmSlotBuffer : public FixedBuffer
+{
+  friend class ShmSegment;
+
+public:
+  ShmSlotBuffer() = default;
+
+  ShmSlotBuffer(ShmSlotBuffer&& other) noexcept { *this = std::move(other); }
+
+  ShmSlotBuffer& operator=(ShmSlotBuffer&& other) noexcept
+  {
+    if (this != &other) {
+      free();
+      FixedBuffer::operator=(std::move(other));
+      state_ = std::exchange(other.state_, nullptr);
+      index_ = other.index_;
+    }
+    return *this;
+  }
+
+  ~ShmSlotBuffer() { free(); }
+
+  size_t index() const { return index_; }
+
+private:
+  ShmSlotBuffer(uint8_t* data,
+                size_t capacity,
+                size_t index,
+                std::atomic<uint32_t>* state)
+    : FixedBuffer{ data, capacity }
+    , index_{ index }
+    , state_{ state }
+  {
+  }
+
+  void free();
+
+  size_t index_ = 0;
+  // State of the slot in the segment, while the slot is held.
+  std::atomic<uint32_t>* state_ = nullptr;
+};
+
+// Published slot, decoded in place. A view dropped without being released
+// frees its slot.
+class ShmSlotView
+{
+  friend class ShmSegment;
+
+public:
+  ShmSlotView() = default;
+
+  ShmSlotView(ShmSlotView&& other) noexcept { *this = std::move(other); }
+
+  ShmSlotView& operator=(ShmSlotView&& other) noexcept
+  {
+    if (this != &other) {
+      free();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      index_ = other.index_;
+      state_ = std::exchange(other.state_, nullptr);
+    }
+    return *this;
+  }
+
+  ~ShmSlotView() { free(); }
+
+  bool valid() const { return nullptr != data_; }
+  size_t size() const { return size_; }
+  size_t index() const { return index_; }
+  uint8_t const* data() const { return data_; }
+
+private:
+  ShmSlotView(uint8_t const* data,
+              size_t size,
+              size_t index,
+              std::atomic<uint32_t>* state)
+    : data_{ data }
+    , size_{ size }
+    , index_{ index }
+    , state_{ state }
+  {
+  }
+
+  void free();
+
+  uint8_t const* data_ = nullptr;
+  size_t size_ = 0;
+  size_t index_ = 0;
+  std::atomic<uint32_t>* state_ = nullptr;
+};
+
+template<>
+struct BufferTraits<ShmSlotBuffer> : BufferTraits<FixedBuffer>
+{
+  using buffer_type = ShmSlotBuffer;
+};
+
+// Read-only, like the SharedBuffer traits.
+template<>
+struct BufferTraits<ShmSlotView>
+{
+  using buffer_type = ShmSlotView;
+
+  static size_t size(buffer_type const& buffer) { return buffer.size(); }
+
+  static void copy(buffer_type const& buffer,
+                   size_t position,
+                   uint8_t* data,
+                   size_t size)
+  {
+    std::memcpy(data, buffer.data() + position, size);
+  }
+
+  static uint8_t const* contiguous(buffer_type const& buffer,
+                                   size_t position,
+                                   size_t /* size */)
+  {
+    return buffer.data() + position;
+  }
+
+  template<typename F>
+  static void for_each_chunk(buffer_type const& buffer,
+                             size_t position,
+                             size_t size,
+                             F&& function)
+  {
+    function(buffer.data() + position, size);
+  }
+};
+
+// Fixed number of fixed-size slots in a POSIX shared-memory object, shared
+// by the processes that map it. A writer acquires a free slot, serializes
+// into it and publishes it. A reader takes the oldest published slot,
+// deserializes it in place and releases it. Slots change hands through an
+// atomic state each, so no lock nor external service is involved. Buffers
+// and views free their slot when dropped, so they shall not outlive the
+// segment they come from.
+class ShmSegment
+{
+  friend class ShmSlotBuffer;
+  friend class ShmSlotView;
+
+public:
+  ShmSegment() = default;
+
+  ShmSegment(ShmSegment&& other) noexcept { *this = std::move(other); }
+
+  ShmSegment& operator=(ShmSegment&& other) noexcept
+  {
+    std::swap(fd_, other.fd_);
+    std::swap(base_, other.base_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~ShmSegment()
+  {
+    if (nullptr != base_) {
+      ::munmap(base_, size_);
+    }
+    if (-1 != fd_) {
+      ::close(fd_);
+    }
+  }
+
+  // Creates a named segment, which other processes open by its name. The
+  // name shall start with a slash and be removed with unlink().
+  static ShmSegment create(std::string const& name,
+                           size_t slot_count,
+                           size_t slot_size)
+  {
+    return create(::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600),
+                  slot_count,
+                  slot_size);
+  }
+
+  static ShmSegment open(std::string const& name)
+  {
+    return open(::shm_open(name.c_str(), O_RDWR, 0));
+  }
+
+  static bool unlink(std::string const& name)
+  {
+    return 0 == ::shm_unlink(name.c_str());
+  }
+
+#ifdef MFD_CLOEXEC
+  // Creates an unnamed segment, whose descriptor is passed to other
+  // processes, e.g. through SCM_RIGHTS.
+  static ShmSegment create_anonymous(size_t slot_count, size_t slot_size)
+  {
+    return create(
+      ::memfd_create("xcdr2", MFD_CLOEXEC), slot_count, slot_size);
+  }
+#endif
+
+  // Takes over a descriptor of an already created segment.
+  static ShmSegment open(int fd) { return map(fd, 0, 0); }
+
+  bool valid() const { return nullptr != base_; }
+  int fd() const { return fd_; }
+  size_t slot_count() const { return valid() ? header()->slot_count : 0; }
+  size_t slot_size() const { return valid() ? header()->slot_size : 0; }
+
+  // Free slot to serialize into, or an invalid buffer if all are in use.
+  ShmSlotBuffer acquire()
+  {
+    for (size_t index = 0; index < slot_count(); ++index) {
+      uint32_t expected = free_slot;
+      if (slot(index)->state.compare_exchange_strong(
+            expected, writing_slot, std::memory_order_acquire)) {
+        return ShmSlotBuffer{
+          data(index), slot_size(), index, &slot(index)->state
+        };
+      }
+    }
+    return ShmSlotBuffer{};
+  }
+
+  // Makes the serialized data visible to readers. An overflowed buffer, or
+  // one acquired through another segment or mapping, is not published and
+  // its slot is freed.
+  bool publish(ShmSlotBuffer&& buffer)
+  {
+    ShmSlotBuffer published{ std::move(buffer) };
+    if (!published.valid()) {
+      return false;
+    }
+    if (published.overflowed() || (slot_count() <= published.index()) ||
+        (&slot(published.index())->state != published.state_)) {
+      return false;
+    }
+    Slot* target = slot(published.index());
+    target->size = published.size();
+    target->sequence.store(
+      header()->sequence.fetch_add(1, std::memory_order_relaxed),
+      std::memory_order_relaxed);
+    published.state_ = nullptr;
+    target->state.store(ready_slot, std::memory_order_release);
+    return true;
+  }
+
+  // Oldest published slot, or an invalid view if there is none. The size
+  // the writer recorded is trusted up to the slot size only.
+  ShmSlotView take()
+  {
+    for (;;) {
+      size_t oldest = slot_count();
+      uint64_t sequence = std::numeric_limits<uint64_t>::max();
+      for (size_t index = 0; index < slot_count(); ++index) {
+        Slot* candidate = slot(index);
+        if (ready_slot == candidate->state.load(std::memory_order_acquire)) {
+          // The slot may be claimed and rewritten meanwhile, in which case
+          // the claim below fails and the scan starts over.
+          const uint64_t candidate_sequence =
+            candidate->sequence.load(std::memory_order_relaxed);
+          if (candidate_sequence < sequence) {
+            oldest = index;
+            sequence = candidate_sequence;
+          }
+        }
+      }
+      if (slot_count() == oldest) {
+        return ShmSlotView{};
+      }
+      uint32_t expected = ready_slot;
+      Slot* target = slot(oldest);
+      if (target->state.compare_exchange_strong(
+            expected, reading_slot, std::memory_order_acquire)) {
+        return ShmSlotView{ data(oldest),
+                            std::min<size_t>(target->size, slot_size()),
+                            oldest,
+                            &target->state };
+      }
+    }
+  }
+
+  // Frees the slot of a taken view.
+  void release(ShmSlotView&& view)
+  {
+    ShmSlotView released{ std::move(view) };
+  }
+
+private:
+  static constexpr uint32_t magic = 0x58434452; // "XCDR"
+
+  enum : uint32_t
+  {
+    free_slot,
+    writing_slot,
+    ready_slot,
+    reading_slot
+  };
+
+  struct alignas(64) Header
+  {
+    std::atomic<uint32_t> magic;
+    uint32_t slot_count;
+    uint64_t slot_size;
+    std::atomic<uint64_t> sequence;
+  };
+
+  struct alignas(64) Slot
+  {
+    std::atomic<uint32_t> state;
+    uint32_t size;
+    std::atomic<uint64_t> sequence;
+  };
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+                "shared atomics shall be lock free");
+
+  static size_t stride(size_t slot_size)
+  {
+    return sizeof(Slot) + ((slot_size + alignof(Slot) - 1) &
+                           ~(alignof(Slot) - 1));
+  }
+
+  static ShmSegment create(int fd, size_t slot_count, size_t slot_size)
+  {
+    if (-1 == fd) {
+      return ShmSegment{};
+    }
+    if ((0 == slot_count) ||
+        (std::numeric_limits<uint32_t>::max() < slot_count) ||
+        (std::numeric_limits<uint32_t>::max() < slot_size)) {
+      ::close(fd);
+      return ShmSegment{};
+    }
+    ShmSegment segment = map(fd, slot_count, slot_size);
+    if (segment.valid()) {
+      Header* header = new (segment.base_)
+        Header{ { 0 }, static_cast<uint32_t>(slot_count), slot_size, { 0 } };
+      for (size_t index = 0; index < slot_count; ++index) {
+        new (segment.slot(index)) Slot{ { free_slot }, 0, { 0 } };
+      }
+      header->magic.store(magic, std::memory_order_release);
+    }
+    return segment;
+  }
+
+  // Maps fd, sizing it first when slot_count is not zero, or reading its
+  // layout from its header otherwise.
+  static ShmSegment map(int fd, size_t slot_count, size_t slot_size)
+  {
+    ShmSegment segment{};
+    if (-1 == fd) {
+      return segment;
+    }
+    segment.fd_ = fd;
+    size_t size = sizeof(Header) + slot_count * stride(slot_size);
+    if (0 != slot_count) {
+      if (0 != ::ftruncate(fd, static_cast<off_t>(size))) {
+        return segment;
+      }
+    } else {
+      struct stat status;
+      if ((0 != ::fstat(fd, &status)) ||
+          (static_cast<size_t>(status.st_size) < sizeof(Header))) {
+        return segment;
+      }
+      size = static_cast<size_t>(status.st_size);
+    }
+    void* base =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == base) {
+      return segment;
+    }
+    segment.base_ = base;
+    segment.size_ = size;
+    if (0 == slot_count) {
+      Header const* header = segment.header();
+      if ((magic != header->magic.load(std::memory_order_acquire)) ||
+          (size < sizeof(Header) +
+                    header->slot_count * stride(header->slot_size))) {
+        return ShmSegment{};
+      }
+    }
+    return segment;
+  }
+
+  Header* header() const { return static_cast<Header*>(base_); }
+
+  Slot* slot(size_t index) const
+  {
+    return reinterpret_cast<Slot*>(static_cast<uint8_t*>(base_) +
+                                   sizeof(Header) +
+                                   index * stride(header()->slot_size));
+  }
+
+  uint8_t* data(size_t index) const
+  {
+    return reinterpret_cast<uint8_t*>(slot(index) + 1);
+  }
+
+  int fd_ = -1;
+  void* base_ = nullptr;
+  size_t size_ = 0;
+};
+
+inline void
+ShmSlotBuffer::free()
+{
+  if (nullptr != state_) {
+    state_->store(ShmSegment::free_slot, std::memory_order_release);
+    state_ = nullptr;
+  }
+}
+
+inline void
+ShmSlotView::free()
+{
+  if (nullptr != state_) {
+    state_->store(ShmSegment::free_slot, std::memory_order_release);
+    state_ = nullptr;
+  }
+}
+
+template<Endian E>
+using ShmWriterEndian = Stream<E, ShmSlotBuffer>;
+using ShmWriter = ShmWriterEndian<Endian::native>;
+
+template<Endian E>
+using ShmReaderEndian = Stream<E, ShmSlotView>;
+using ShmReader = ShmReaderEndian<Endian::native>;
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__XCDR2_SHM
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_SHM_HPP_
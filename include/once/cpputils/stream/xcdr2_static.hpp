@@ -0,0 +1,172 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ONCE__CPPUTILS__STREAM__XCDR2_STATIC_HPP_
+#define ONCE__CPPUTILS__STREAM__XCDR2_STATIC_HPP_
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace once {
+namespace cpputils {
+namespace xcdr2 {
+
+// Largest alignment XCDR2 requires: 8 byte values are aligned to 4.
+inline constexpr size_t max_alignment = 4;
+
+namespace detail {
+
+template<size_t Size>
+using unsigned_of_size_t = std::conditional_t<
+  1 == Size,
+  uint8_t,
+  std::conditional_t<2 == Size,
+                     uint16_t,
+                     std::conditional_t<4 == Size, uint32_t, uint64_t>>>;
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_bit_cast)
+#define ONCE__CPPUTILS__XCDR2_BUILTIN_BIT_CAST
+#endif
+#elif defined(_MSC_VER) && (1927 <= _MSC_VER)
+#define ONCE__CPPUTILS__XCDR2_BUILTIN_BIT_CAST
+#endif
+
+// Integers convert in constant expressions anywhere; floating point values
+// only where the compiler provides the builtin.
+template<typename U, typename T>
+constexpr U
+bits_of(T data)
+{
+  if constexpr (std::is_integral<T>::value) {
+    return static_cast<U>(data);
+  } else {
+#if defined(ONCE__CPPUTILS__XCDR2_BUILTIN_BIT_CAST)
+    return __builtin_bit_cast(U, data);
+#else
+    U bits{};
+    std::memcpy(&bits, &data, sizeof(U));
+    return bits;
+#endif
+  }
+}
+
+} // namespace detail
+
+// Encoder usable in constant expressions, to bake messages or parts of them
+// that are known at compile time into read-only data:
+//
+//   constexpr auto header = [] {
+//     xcdr2::StaticStream<Endian::little, 32> stream{};
+//     stream << uint16_t{ 1 } << std::string_view{ "telemetry" };
+//     return stream;
+//   }();
+//   static_assert(!header.overflowed());
+//
+// It follows the Stream encoding rules for arithmetic values, strings and
+// arrays. Writing past N sets the overflowed flag and drops the bytes.
+template<Endian E, size_t N>
+class StaticStream
+{
+public:
+  constexpr uint8_t const* data() const { return buffer_.data(); }
+  constexpr size_t size() const { return size_; }
+  constexpr bool overflowed() const { return overflowed_; }
+  constexpr std::array<uint8_t, N> const& buffer() const { return buffer_; }
+
+  template<typename T,
+           typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+  constexpr StaticStream& operator<<(T data)
+  {
+    constexpr size_t size = sizeof(T);
+    static_assert(size <= sizeof(uint64_t));
+    align(std::min(size, max_alignment));
+    using U = detail::unsigned_of_size_t<size>;
+    const U bits = detail::bits_of<U>(data);
+    for (size_t i = 0; i < size; ++i) {
+      const size_t byte = (Endian::little == E) ? i : size - 1 - i;
+      put(static_cast<uint8_t>(bits >> (8 * byte)));
+    }
+    return *this;
+  }
+
+  constexpr StaticStream& operator<<(std::string_view data)
+  {
+    *this << static_cast<uint32_t>(data.size());
+    for (char c : data) {
+      put(static_cast<uint8_t>(c));
+    }
+    return *this;
+  }
+
+  template<typename T, size_t M>
+  constexpr StaticStream& operator<<(std::array<T, M> const& data)
+  {
+    for (auto&& item : data) {
+      *this << item;
+    }
+    return *this;
+  }
+
+private:
+  constexpr void align(size_t alignment)
+  {
+    const size_t remainder = size_ & (alignment - 1);
+    for (size_t i = remainder ? alignment - remainder : 0; 0 < i; --i) {
+      put(0);
+    }
+  }
+
+  constexpr void put(uint8_t byte)
+  {
+    if (N == size_) {
+      overflowed_ = true;
+      return;
+    }
+    buffer_[size_++] = byte;
+  }
+
+  std::array<uint8_t, N> buffer_{};
+  size_t size_ = 0;
+  bool overflowed_ = false;
+};
+
+// Copies pre-encoded bytes into a stream of the same endianness. Their
+// alignment only holds when they start at a multiple of max_alignment; padding
+// them there would misplace them for the reader, so anywhere else the
+// serialization fails. An overflowed template is truncated, so it is not
+// copied either and the serialization fails.
+template<Endian E, typename B, size_t N>
+Stream<E, B>&
+operator<<(Stream<E, B>& stream, StaticStream<E, N> const& data)
+{
+  if (data.overflowed() || (0 != stream.ser_length() % max_alignment)) {
+    stream.set_ser_error();
+    return stream;
+  }
+  return stream.write(data.data(), data.size(), 1);
+}
+
+} // namespace xcdr2
+} // namespace cpputils
+} // namespace once
+
+#endif // ONCE__CPPUTILS__STREAM__XCDR2_STATIC_HPP_
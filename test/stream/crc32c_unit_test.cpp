@@ -0,0 +1,67 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/crc32c.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace once::cpputils;
+
+TEST_CASE("crc32c::compute")
+{
+  SECTION("matches the check value")
+  {
+    std::string data{ "123456789" };
+    auto ptr = reinterpret_cast<uint8_t const*>(data.data());
+    REQUIRE(crc32c::compute(ptr, data.size()) == 0xE3069283);
+    REQUIRE(crc32c::detail::software(~0u, ptr, data.size()) == ~0xE3069283);
+  }
+
+  SECTION("an empty buffer has a zero checksum")
+  {
+    REQUIRE(crc32c::compute(nullptr, 0) == 0);
+  }
+
+  SECTION("extending matches computing at once for every split")
+  {
+    std::vector<uint8_t> data(123);
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    const uint32_t whole = crc32c::compute(data.data(), data.size());
+    for (size_t split = 0; split <= data.size(); ++split) {
+      uint32_t crc = crc32c::compute(data.data(), split);
+      crc = crc32c::extend(crc, data.data() + split, data.size() - split);
+      REQUIRE(crc == whole);
+    }
+  }
+
+  SECTION("the software path matches for every alignment")
+  {
+    std::vector<uint8_t> data(100);
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<uint8_t>(i * 17 + 3);
+    }
+    for (size_t offset = 0; offset < 8; ++offset) {
+      const size_t size = data.size() - offset;
+      REQUIRE(~crc32c::detail::software(~0u, data.data() + offset, size) ==
+              crc32c::compute(data.data() + offset, size));
+    }
+  }
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <once/cpputils/stream/json.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#ifdef ONCE__CPPUTILS__STREAM_FD_SINK
+#include <fcntl.h>
+#endif
+
+using namespace once::cpputils;
+
+using Json = stream::Json;
+
+static_assert(std::is_constructible<Json::Identifier, std::string&>::value);
+static_assert(std::is_constructible<Json::Identifier, char const*>::value);
+static_assert(
+  !std::is_constructible<Json::Identifier, std::string&&>::value);
+static_assert(
+  !std::is_constructible<Json::Identifier, std::string const&&>::value);
+
+TEST_CASE("stream::Json")
+{
+  stream::StringSink sink{};
+
+  SECTION("writes members of every kind")
+  {
+    const int answer = 42;
+    {
+      Json json{ sink };
+      json << Json::Object::begin << Json::Member<int>{ "int", -7 }
+           << Json::Member<uint64_t>{ "max",
+                                      std::numeric_limits<uint64_t>::max() }
+           << Json::Member<bool>{ "flag", true }
+           << Json::Member<double>{ "ratio", 0.25 }
+           << Json::Member<float>{ "nan", std::nanf("") }
+           << Json::Member<char const*>{ "text", "a\"b\\c\n\x01" }
+           << Json::Member<std::string>{ "string", "plain" }
+           << Json::Member<int const*>{ "pointer", &answer }
+           << Json::Member<int const*>{ "null", nullptr }
+           << Json::Member<std::vector<int>>{ "vector", { 1, 2, 3 } }
+           << Json::Member<std::array<bool, 2>>{ "array", { true, false } }
+           << Json::Member<std::vector<std::string>>{ "empty", {} }
+           << Json::Member<std::optional<int>>{ "some", 5 }
+           << Json::Member<std::optional<int>>{ "none", std::nullopt }
+           << Json::Object::end;
+      REQUIRE(sink.str().empty());
+    }
+    REQUIRE(sink.str() ==
+            "{\"int\":-7,\"max\":18446744073709551615,\"flag\":true,"
+            "\"ratio\":0.25,\"nan\":null,\"text\":\"a\\\"b\\\\c\\n\\u0001\","
+            "\"string\":\"plain\",\"pointer\":42,\"null\":null,"
+            "\"vector\":[1,2,3],\"array\":[true,false],\"empty\":[],"
+            "\"some\":5,\"none\":null}");
+  }
+
+  SECTION("hands full buffers to the sink")
+  {
+    const std::string large(Json::buffer_size * 2, 'x');
+    Json json{ sink };
+    json << Json::Object::begin;
+    for (int i = 0; i < 1000; ++i) {
+      json << Json::Member<int>{ "value", i };
+    }
+    REQUIRE(!sink.str().empty());
+    json << Json::Member<std::string>{ "large", large } << Json::Object::end;
+    json.flush();
+    REQUIRE(sink.str().size() ==
+            1 + 10 * 9 + 90 * 10 + 900 * 11 + 1000 + 10 + large.size() + 1);
+    REQUIRE(sink.str().substr(0, 20) == "{\"value\":0,\"value\":1");
+  }
+
+  SECTION("stops at the capacity of a fixed sink")
+  {
+    char data[8];
+    stream::FixedSink fixed{ data, sizeof(data) };
+    {
+      Json json{ fixed };
+      json << Json::Object::begin << Json::Member<int>{ "a", 1 }
+           << Json::Object::end;
+    }
+    REQUIRE(!fixed.overflowed());
+    REQUIRE(std::string(fixed.data(), fixed.size()) == "{\"a\":1}");
+    {
+      Json json{ fixed };
+      json << Json::Object::begin << Json::Object::end;
+    }
+    REQUIRE(fixed.overflowed());
+    REQUIRE(fixed.size() == 7);
+  }
+
+  SECTION("writes floating-point values in their shortest round-trip form")
+  {
+    const std::vector<double> values{ 0.1,
+                                      1.0 / 3,
+                                      -2.5e-300,
+                                      std::numeric_limits<double>::max(),
+                                      123456789.0 };
+    {
+      Json json{ sink };
+      json << Json::Object::begin << Json::Member<float>{ "float", 0.1f }
+           << Json::Member<std::vector<double>>{ "doubles", values }
+           << Json::Object::end;
+    }
+    REQUIRE(sink.str() == "{\"float\":0.1,\"doubles\":[0.1,"
+                          "0.3333333333333333,-2.5e-300,"
+                          "1.7976931348623157e+308,123456789]}");
+  }
+
+  SECTION("writes floating-point values with a fixed precision")
+  {
+    {
+      Json json{ sink };
+      REQUIRE(!json.fixed_precision());
+      json.set_fixed_precision(2);
+      REQUIRE(json.fixed_precision() == 2);
+      json << Json::Object::begin << Json::Member<double>{ "pi", 3.14159 }
+           << Json::Member<float>{ "whole", 7.0f }
+           << Json::Member<double>{ "large", -1e22 };
+      json.set_fixed_precision(1000);
+      REQUIRE(json.fixed_precision() == Json::max_fixed_precision);
+      json.set_fixed_precision(std::nullopt);
+      json << Json::Member<double>{ "shortest", 2.5 } << Json::Object::end;
+    }
+    REQUIRE(sink.str() == "{\"pi\":3.14,\"whole\":7.00,"
+                          "\"large\":-10000000000000000000000.00,"
+                          "\"shortest\":2.5}");
+  }
+
+  SECTION("fits the widest fixed precision values in its buffer")
+  {
+    {
+      Json json{ sink };
+      json.set_fixed_precision(Json::max_fixed_precision);
+      json << Json::Object::begin;
+      for (int i = 0; i < 20; ++i) {
+        json << Json::Member<double>{
+          "v", -std::numeric_limits<double>::max()
+        };
+      }
+      json << Json::Object::end;
+    }
+    const size_t value_size = 1 + 309 + 1 + Json::max_fixed_precision;
+    REQUIRE(sink.str().size() == 2 + 20 * (4 + value_size) + 19);
+  }
+
+#ifdef ONCE__CPPUTILS__STREAM_FD_SINK
+  SECTION("writes to a file descriptor")
+  {
+    std::FILE* file = std::tmpfile();
+    REQUIRE(nullptr != file);
+    stream::FdSink fd_sink{ fileno(file) };
+    {
+      Json json{ fd_sink };
+      json << Json::Object::begin << Json::Member<char const*>{ "k", "v" }
+           << Json::Object::end;
+    }
+    REQUIRE(!fd_sink.failed());
+    std::rewind(file);
+    char data[16]{};
+    REQUIRE(std::fread(data, 1, sizeof(data), file) == 9);
+    REQUIRE(std::string(data, 9) == "{\"k\":\"v\"}");
+    std::fclose(file);
+  }
+
+  SECTION("reports a failed write to a file descriptor")
+  {
+    const int fd = ::open("/dev/full", O_WRONLY);
+    if (-1 != fd) {
+      stream::FdSink fd_sink{ fd };
+      {
+        Json json{ fd_sink };
+        json << Json::Object::begin << Json::Member<char const*>{ "k", "v" }
+             << Json::Object::end;
+      }
+      REQUIRE(fd_sink.failed());
+      REQUIRE(fd_sink.error() == ENOSPC);
+      ::close(fd);
+    }
+  }
+#endif
+}
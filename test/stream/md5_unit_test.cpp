@@ -0,0 +1,55 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/md5.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace once::cpputils;
+
+namespace {
+
+md5::Digest
+digest_of(std::string const& data)
+{
+  return md5::compute(reinterpret_cast<uint8_t const*>(data.data()),
+                      data.size());
+}
+
+md5::Digest
+digest_from(std::string const& hex)
+{
+  md5::Digest digest;
+  for (size_t i = 0; i < digest.size(); ++i) {
+    digest[i] = static_cast<uint8_t>(std::stoul(hex.substr(i * 2, 2), 0, 16));
+  }
+  return digest;
+}
+
+} // namespace
+
+TEST_CASE("md5::compute")
+{
+  REQUIRE(digest_of("") == digest_from("d41d8cd98f00b204e9800998ecf8427e"));
+  REQUIRE(digest_of("abc") == digest_from("900150983cd24fb0d6963f7d28e17f72"));
+  REQUIRE(digest_of("The quick brown fox jumps over the lazy dog") ==
+          digest_from("9e107d9d372bb6826bd81d3542a419d6"));
+  REQUIRE(digest_of("12345678901234567890123456789012345678901234567890123456"
+                    "789012345678901234567890") ==
+          digest_from("57edf4a22be3c955ac49da2e2107b67a"));
+}
@@ -20,7 +20,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <deque>
+#include <forward_list>
 #include <limits>
+#include <list>
 #include <utility>
 
 using namespace once::cpputils;
@@ -140,3 +143,340 @@ TEMPLATE_TEST_CASE_SIG("xcdr2::Stream",
     TEST_DESERIALIZE(double)
   }
 }
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Stream with a CRC32C trailer",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  xcdr2::VectorStreamEndian<E> stream{};
+  stream.set_trailer(xcdr2::Trailer::crc32c);
+  std::vector<uint32_t> ser_data(5000);
+  for (size_t i = 0; i < ser_data.size(); ++i) {
+    ser_data[i] = static_cast<uint32_t>(i * 2654435761u);
+  }
+  std::string ser_text{ "trailer" };
+  stream << ser_data << ser_text;
+  const size_t payload_length = stream.ser_length();
+  stream.seal();
+
+  SECTION("sealing appends the checksum of the serialized data")
+  {
+    REQUIRE(stream.ser_length() == payload_length + sizeof(uint32_t));
+    uint32_t crc = crc32c::compute(stream.buffer().data(), payload_length);
+    xcdr2::VectorStreamEndian<E> expected{};
+    expected << crc;
+    REQUIRE(std::equal(expected.buffer().begin(),
+                       expected.buffer().end(),
+                       stream.buffer().begin() + payload_length));
+  }
+
+  SECTION("sealing again appends nothing")
+  {
+    const std::vector<uint8_t> sealed = stream.buffer();
+    stream.seal();
+    REQUIRE(stream.buffer() == sealed);
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::ok);
+    REQUIRE(stream.verify());
+  }
+
+  SECTION("deserializing verifies the checksum")
+  {
+    std::vector<uint32_t> deser_data;
+    std::string deser_text;
+    stream >> deser_data >> deser_text;
+    REQUIRE(deser_data == ser_data);
+    REQUIRE(deser_text == ser_text);
+    REQUIRE(stream.verify());
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+
+    uint8_t extra;
+    stream >> extra;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+
+  SECTION("a partial deserialization still verifies the whole buffer")
+  {
+    uint32_t length;
+    stream >> length;
+    REQUIRE(stream.verify());
+  }
+}
+
+TEST_CASE("xcdr2::Stream detects corrupted data through the CRC32C trailer")
+{
+  xcdr2::VectorStream ser_stream{};
+  ser_stream.set_trailer(xcdr2::Trailer::crc32c);
+  ser_stream << std::string{ "corrupted" } << uint64_t{ 42 };
+  ser_stream.seal();
+
+  std::vector<uint8_t> corrupted{ ser_stream.buffer() };
+  corrupted[6] ^= 0x01;
+  xcdr2::VectorStream deser_stream{};
+  deser_stream.write(corrupted.data(), corrupted.size());
+  deser_stream.set_trailer(xcdr2::Trailer::crc32c);
+
+  std::string text;
+  uint64_t value;
+  deser_stream >> text >> value;
+  REQUIRE(deser_stream.deser_state() == xcdr2::StreamState::ok);
+  REQUIRE_FALSE(deser_stream.verify());
+  REQUIRE(deser_stream.deser_state() == xcdr2::StreamState::error);
+}
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Stream with std::vector<bool>",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  xcdr2::VectorStreamEndian<E> stream{};
+  std::vector<bool> ser_data(1000);
+  for (size_t i = 0; i < ser_data.size(); ++i) {
+    ser_data[i] = (0 == i % 3) || (0 == i % 7);
+  }
+
+  SECTION("serializing one byte per element")
+  {
+    stream << ser_data;
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::ok);
+    REQUIRE(sizeof(uint32_t) + ser_data.size() == stream.ser_length());
+    REQUIRE(stream.buffer()[sizeof(uint32_t)] == 1);
+    REQUIRE(stream.buffer()[sizeof(uint32_t) + 1] == 0);
+
+    SECTION("deserializing one byte per element")
+    {
+      std::vector<bool> deser_data{ true };
+      stream >> deser_data;
+      REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+      REQUIRE(deser_data == ser_data);
+      REQUIRE(stream.deser_length() == stream.ser_length());
+    }
+  }
+
+  SECTION("serializing one bit per element")
+  {
+    stream << xcdr2::packed(ser_data);
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::ok);
+    REQUIRE(sizeof(uint32_t) + (ser_data.size() + 7) / 8 ==
+            stream.ser_length());
+    REQUIRE(stream.buffer()[sizeof(uint32_t)] == 0b11001001);
+
+    SECTION("deserializing one bit per element")
+    {
+      std::vector<bool> deser_data;
+      stream >> xcdr2::packed(deser_data);
+      REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+      REQUIRE(deser_data == ser_data);
+      REQUIRE(stream.deser_length() == stream.ser_length());
+    }
+  }
+
+  SECTION("deserializing a truncated sequence fails")
+  {
+    stream << uint32_t{ 10 } << true;
+    std::vector<bool> deser_data;
+    stream >> deser_data;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+}
+
+TEST_CASE("xcdr2::Stream buffer ownership transfer")
+{
+  xcdr2::VectorStream ser_stream{};
+  ser_stream << uint32_t{ 7 } << std::string{ "owned" };
+  const std::vector<uint8_t> expected{ ser_stream.buffer() };
+  auto data_ptr = ser_stream.buffer().data();
+
+  std::vector<uint8_t> buffer = ser_stream.release();
+
+  SECTION("releasing moves the buffer out and resets the stream")
+  {
+    REQUIRE(buffer == expected);
+    REQUIRE(buffer.data() == data_ptr);
+    REQUIRE(ser_stream.buffer().empty());
+    REQUIRE(0 == ser_stream.ser_length());
+    REQUIRE(0 == ser_stream.deser_length());
+    ser_stream << uint8_t{ 1 };
+    REQUIRE(1 == ser_stream.ser_length());
+  }
+
+  SECTION("constructing from a buffer takes it over for deserialization")
+  {
+    xcdr2::VectorStream deser_stream{ std::move(buffer) };
+    REQUIRE(deser_stream.buffer().data() == data_ptr);
+    REQUIRE(deser_stream.ser_length() == expected.size());
+    uint32_t value;
+    std::string text;
+    deser_stream >> value >> text;
+    REQUIRE(deser_stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(value == 7);
+    REQUIRE(text == "owned");
+  }
+
+  SECTION("adopting a buffer restarts the deserialization")
+  {
+    xcdr2::VectorStream deser_stream{};
+    deser_stream << uint64_t{ 1 };
+    uint8_t byte;
+    deser_stream >> byte >> byte;
+    deser_stream.adopt(std::move(buffer));
+    REQUIRE(deser_stream.deser_length() == 0);
+    uint32_t value;
+    deser_stream >> value;
+    REQUIRE(value == 7);
+  }
+}
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Stream with xcdr2::Span",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  xcdr2::VectorStreamEndian<E> stream{};
+
+  SECTION("deserializing aligned floats")
+  {
+    std::vector<float> ser_data{ 0.5f, 1.5f, 2.5f, 3.5f };
+    stream << ser_data;
+    xcdr2::Span<float> deser_data;
+    stream >> deser_data;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(stream.deser_length() == stream.ser_length());
+    REQUIRE(std::equal(deser_data.begin(),
+                       deser_data.end(),
+                       ser_data.begin(),
+                       ser_data.end()));
+    if constexpr (E == Endian::native) {
+      REQUIRE(deser_data.borrowed());
+      REQUIRE(static_cast<void const*>(deser_data.data()) ==
+              static_cast<void const*>(stream.buffer().data() + 4));
+    } else {
+      REQUIRE_FALSE(deser_data.borrowed());
+    }
+  }
+
+  SECTION("deserializing misaligned doubles falls back to a copy")
+  {
+    std::vector<double> ser_data{ 0.25, -1.0, 1e100 };
+    stream << ser_data;
+    xcdr2::Span<double> deser_data;
+    stream >> deser_data;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE_FALSE(deser_data.borrowed());
+    REQUIRE(deser_data.size() == ser_data.size());
+    REQUIRE(deser_data[2] == ser_data[2]);
+  }
+
+  SECTION("deserializing an empty sequence")
+  {
+    stream << std::vector<uint32_t>{};
+    xcdr2::Span<uint32_t> deser_data;
+    stream >> deser_data;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_data.empty());
+  }
+
+  SECTION("deserializing a truncated sequence fails")
+  {
+    stream << uint32_t{ 3 } << uint32_t{ 1 };
+    xcdr2::Span<uint32_t> deser_data;
+    stream >> deser_data;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+}
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Stream with xcdr2::sequence",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  xcdr2::VectorStreamEndian<E> stream{};
+  xcdr2::VectorStreamEndian<E> expected{};
+
+  SECTION("serializing contiguous ranges in bulk")
+  {
+    double values[300];
+    for (size_t i = 0; i < 300; ++i) {
+      values[i] = 0.5 * i;
+    }
+    stream << uint8_t{ 1 } << xcdr2::sequence(values);
+    stream << std::vector<int16_t>{ 1, -2, 3 };
+    expected << uint8_t{ 1 } << uint32_t{ 300 };
+    for (double value : values) {
+      expected << value;
+    }
+    expected << uint32_t{ 3 } << int16_t{ 1 } << int16_t{ -2 } << int16_t{ 3 };
+    REQUIRE(stream.buffer() == expected.buffer());
+
+    uint8_t first{};
+    std::vector<double> deser_values;
+    stream >> first >> deser_values;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(std::equal(deser_values.begin(),
+                       deser_values.end(),
+                       std::begin(values),
+                       std::end(values)));
+  }
+
+  SECTION("serializing sized ranges element by element")
+  {
+    std::deque<uint16_t> values{ 1, 2, 3, 4, 5 };
+    stream << xcdr2::sequence(values);
+    expected << std::vector<uint16_t>(values.begin(), values.end());
+    REQUIRE(stream.buffer() == expected.buffer());
+
+    std::deque<uint16_t> deser_values{ 9 };
+    stream >> xcdr2::sequence(deser_values);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_values == values);
+  }
+
+  SECTION("serializing unsized forward ranges")
+  {
+    std::forward_list<std::string> values{ "a", "forward", "list" };
+    stream << xcdr2::sequence(values);
+    expected << std::vector<std::string>(values.begin(), values.end());
+    REQUIRE(stream.buffer() == expected.buffer());
+
+    std::list<std::string> deser_values;
+    stream >> xcdr2::sequence(deser_values);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(std::equal(deser_values.begin(),
+                       deser_values.end(),
+                       values.begin(),
+                       values.end()));
+  }
+
+  SECTION("serializing temporary and const ranges")
+  {
+    const std::list<uint16_t> values{ 4, 5 };
+    stream << xcdr2::sequence(std::deque<uint16_t>{ 1, 2, 3 })
+           << xcdr2::sequence(values);
+    expected << std::vector<uint16_t>{ 1, 2, 3 }
+             << std::vector<uint16_t>{ 4, 5 };
+    REQUIRE(stream.buffer() == expected.buffer());
+  }
+
+  SECTION("deserializing a truncated sequence fails")
+  {
+    stream << uint32_t{ 1000 } << std::string{ "only one" };
+    std::list<std::string> deser_values;
+    stream >> xcdr2::sequence(deser_values);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(deser_values == std::list<std::string>{ "only one" });
+  }
+
+  SECTION("a failed element is not kept")
+  {
+    stream << uint32_t{ 2 } << std::string{ "whole" } << uint32_t{ 100 }
+           << uint8_t{ 'x' };
+    std::deque<std::string> deser_values;
+    stream >> xcdr2::sequence(deser_values);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(deser_values == std::deque<std::string>{ "whole" });
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_aligned_allocator.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+namespace {
+
+bool
+is_aligned(void const* ptr, size_t alignment)
+{
+  return 0 == reinterpret_cast<uintptr_t>(ptr) % alignment;
+}
+
+} // namespace
+
+TEST_CASE("xcdr2::AlignedAllocator")
+{
+  xcdr2::AlignedAllocator<uint8_t> allocator{};
+
+  SECTION("small allocations are cache-line aligned")
+  {
+    for (size_t size : { 1, 17, 100, 4096 }) {
+      auto ptr = allocator.allocate(size);
+      REQUIRE(is_aligned(ptr, xcdr2::cache_line_size));
+      ptr[size - 1] = 0xFF;
+      allocator.deallocate(ptr, size);
+    }
+  }
+
+  SECTION("large allocations are mapped and cache-line aligned")
+  {
+    const size_t size = 3 * xcdr2::huge_page_size + 1;
+    auto ptr = allocator.allocate(size);
+    REQUIRE(is_aligned(ptr, xcdr2::cache_line_size));
+    ptr[0] = 0x01;
+    ptr[size - 1] = 0xFF;
+    allocator.deallocate(ptr, size);
+  }
+
+  SECTION("large allocations keep alignments beyond the page size")
+  {
+    constexpr size_t alignment = 1024 * 1024;
+    xcdr2::AlignedAllocator<uint8_t, alignment> wide{};
+    const size_t size = xcdr2::huge_page_size + 1;
+    auto ptr = wide.allocate(size);
+    REQUIRE(is_aligned(ptr, alignment));
+    ptr[size - 1] = 0xFF;
+    wide.deallocate(ptr, size);
+  }
+
+  SECTION("oversized allocations are rejected")
+  {
+    xcdr2::AlignedAllocator<double> doubles{};
+    REQUIRE_THROWS_AS(doubles.allocate(doubles.max_size() + 1),
+                      std::bad_array_new_length);
+  }
+
+  SECTION("rebinding keeps the policy")
+  {
+    using Rebound = std::allocator_traits<
+      xcdr2::AlignedAllocator<uint8_t>>::rebind_alloc<double>;
+    REQUIRE(std::is_same_v<Rebound, xcdr2::AlignedAllocator<double>>);
+  }
+}
+
+TEST_CASE("xcdr2::AlignedStream")
+{
+  xcdr2::AlignedStream stream{};
+  std::vector<double> ser_data(xcdr2::huge_page_size / sizeof(double), 0.5);
+  stream << uint32_t{ 0 } << ser_data;
+  REQUIRE(is_aligned(stream.buffer().data(), xcdr2::cache_line_size));
+
+  uint32_t padding;
+  xcdr2::Span<double> deser_data;
+  stream >> padding >> deser_data;
+  REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+  REQUIRE(deser_data.borrowed());
+  REQUIRE(deser_data.size() == ser_data.size());
+  REQUIRE(deser_data[ser_data.size() - 1] == 0.5);
+
+  auto buffer = stream.release();
+  REQUIRE(buffer.size() == 2 * sizeof(uint32_t) + xcdr2::huge_page_size);
+}
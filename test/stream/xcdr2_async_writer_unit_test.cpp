@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_async_writer.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <string>
+
+#include <dirent.h>
+#include <fcntl.h>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct TemporaryFile
+{
+  TemporaryFile()
+  {
+    char name[] = "/tmp/once_cpputils_xcdr2_XXXXXX";
+    fd = ::mkstemp(name);
+    ::unlink(name);
+  }
+
+  ~TemporaryFile() { ::close(fd); }
+
+  std::vector<uint8_t> contents() const
+  {
+    std::vector<uint8_t> bytes(
+      static_cast<size_t>(::lseek(fd, 0, SEEK_END)));
+    REQUIRE(::pread(fd, bytes.data(), bytes.size(), 0) ==
+            static_cast<ssize_t>(bytes.size()));
+    return bytes;
+  }
+
+  int fd;
+};
+
+// Whether the kernel lets this process set up a ring, in which case the
+// io_uring backend shall not fall back to pwrite.
+bool
+io_uring_available()
+{
+#ifdef ONCE__CPPUTILS__XCDR2_IO_URING
+  io_uring_params params{};
+  const long fd = ::syscall(__NR_io_uring_setup, 1, &params);
+  if (0 <= fd) {
+    ::close(static_cast<int>(fd));
+    return true;
+  }
+#endif
+  return false;
+}
+
+// Descriptor of the only io_uring instance of this process, or -1.
+int
+ring_descriptor()
+{
+  DIR* directory = ::opendir("/proc/self/fd");
+  if (nullptr == directory) {
+    return -1;
+  }
+  int fd = -1;
+  while (dirent* entry = ::readdir(directory)) {
+    const std::string path = std::string{ "/proc/self/fd/" } + entry->d_name;
+    char target[64]{};
+    if ((0 < ::readlink(path.c_str(), target, sizeof(target) - 1)) &&
+        (std::string{ "anon_inode:[io_uring]" } == target)) {
+      fd = std::atoi(entry->d_name);
+    }
+  }
+  ::closedir(directory);
+  return fd;
+}
+
+} // namespace
+
+TEST_CASE("xcdr2::AsyncFileWriter")
+{
+  auto backend = GENERATE(xcdr2::WriteBackend::io_uring,
+                          xcdr2::WriteBackend::pwrite);
+  TemporaryFile file{};
+  REQUIRE(-1 != file.fd);
+
+  SECTION("writes the messages in submission order")
+  {
+    std::vector<uint8_t> expected;
+    {
+      xcdr2::AsyncFileWriter writer{ file.fd, 2, 4096, backend };
+      if ((xcdr2::WriteBackend::io_uring == backend) && io_uring_available()) {
+        REQUIRE(writer.backend() == xcdr2::WriteBackend::io_uring);
+      } else {
+        REQUIRE(writer.backend() == xcdr2::WriteBackend::pwrite);
+      }
+      for (uint32_t i = 0; i < 32; ++i) {
+        xcdr2::AsyncWriterStream stream{ writer.acquire() };
+        REQUIRE(stream.buffer().valid());
+        stream << i << std::string(i, 'x') << std::vector<double>(i, 0.5);
+        expected.insert(expected.end(),
+                        stream.buffer().data(),
+                        stream.buffer().data() + stream.buffer().size());
+        REQUIRE(writer.submit(stream.release()));
+        if (7 == i % 8) {
+          writer.sync();
+        }
+      }
+      REQUIRE(writer.flush());
+      REQUIRE(writer.in_flight() == 0);
+      REQUIRE(writer.offset() == expected.size());
+    }
+    REQUIRE(file.contents() == expected);
+  }
+
+  SECTION("an overflowed buffer is not written")
+  {
+    xcdr2::AsyncFileWriter writer{ file.fd, 1, 64, backend };
+    xcdr2::AsyncWriterStream stream{ writer.acquire() };
+    stream << std::vector<uint64_t>(16, 1);
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::error);
+    REQUIRE(stream.ser_length() == sizeof(uint32_t));
+    REQUIRE_FALSE(writer.submit(stream.release()));
+    REQUIRE(writer.acquire().valid());
+    REQUIRE(writer.flush());
+    REQUIRE(writer.offset() == 0);
+  }
+
+  SECTION("a failed write is reported")
+  {
+    const int fd = ::open("/dev/null", O_RDONLY);
+    {
+      xcdr2::AsyncFileWriter writer{ fd, 1, 64, backend };
+      xcdr2::AsyncWriterStream stream{ writer.acquire() };
+      stream << uint32_t{ 1 };
+      writer.submit(stream.release());
+      REQUIRE_FALSE(writer.flush());
+      REQUIRE(writer.state() == xcdr2::StreamState::error);
+    }
+    ::close(fd);
+  }
+}
+
+TEST_CASE("xcdr2::AsyncFileWriter falls back to pwrite when the ring fails")
+{
+  TemporaryFile file{};
+  REQUIRE(-1 != file.fd);
+  std::vector<uint8_t> expected;
+  const int null_fd = ::open("/dev/null", O_RDONLY);
+  REQUIRE(-1 != null_fd);
+  {
+    xcdr2::AsyncFileWriter writer{ file.fd, 2, 64 };
+    const int ring_fd = ring_descriptor();
+    if ((xcdr2::WriteBackend::io_uring == writer.backend()) &&
+        (-1 != ring_fd)) {
+      for (uint32_t i = 0; i < 2; ++i) {
+        xcdr2::AsyncWriterStream stream{ writer.acquire() };
+        REQUIRE(stream.buffer().valid());
+        stream << i << std::string(i + 1, 'x');
+        expected.insert(expected.end(),
+                        stream.buffer().data(),
+                        stream.buffer().data() + stream.buffer().size());
+        REQUIRE(writer.submit(stream.release()));
+      }
+      // The first write went to the kernel on the second acquire(), while the
+      // second one is still queued when the ring stops accepting entries.
+      REQUIRE(-1 != ::dup2(null_fd, ring_fd));
+      REQUIRE(writer.flush());
+      REQUIRE(writer.state() == xcdr2::StreamState::ok);
+      REQUIRE(writer.in_flight() == 0);
+      auto first = writer.acquire();
+      auto second = writer.acquire();
+      REQUIRE(first.valid());
+      REQUIRE(second.valid());
+      REQUIRE(first.data() != second.data());
+      REQUIRE(file.contents() == expected);
+
+      // Writes keep going through pwrite.
+      xcdr2::AsyncWriterStream stream{ std::move(first) };
+      stream << uint32_t{ 3 };
+      expected.insert(expected.end(),
+                      stream.buffer().data(),
+                      stream.buffer().data() + stream.buffer().size());
+      REQUIRE(writer.submit(stream.release()));
+      REQUIRE(writer.flush());
+      REQUIRE(file.contents() == expected);
+    }
+  }
+  ::close(null_fd);
+}
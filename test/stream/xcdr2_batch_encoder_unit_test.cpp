@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_batch_encoder.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <stdexcept>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Reading
+{
+  uint32_t sensor;
+  std::string unit;
+  std::vector<double> samples;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Reading const& reading)
+{
+  return stream << reading.sensor << reading.unit << reading.samples;
+}
+
+struct Faulty
+{
+  uint32_t value;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Faulty const& faulty)
+{
+  if (0 == faulty.value % 100) {
+    throw std::runtime_error{ "faulty" };
+  }
+  return stream << faulty.value;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::BatchEncoder",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  std::vector<Reading> readings;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    readings.push_back(
+      { i, std::string(i % 7, 'u'), std::vector<double>(i % 13, 0.5 * i) });
+  }
+  auto thread_count = GENERATE(1, 4);
+  xcdr2::BatchEncoder encoder{ static_cast<size_t>(thread_count) };
+  REQUIRE(encoder.thread_count() == static_cast<size_t>(thread_count));
+
+  SECTION("results come out in submission order")
+  {
+    std::vector<std::vector<uint8_t>> results;
+    encoder.encode<E>(readings, results);
+    REQUIRE(results.size() == readings.size());
+    for (size_t i = 0; i < readings.size(); ++i) {
+      xcdr2::VectorStreamEndian<E> expected{};
+      expected << readings[i];
+      REQUIRE(results[i] == expected.buffer());
+    }
+  }
+
+  SECTION("result buffers are reused")
+  {
+    std::vector<std::vector<uint8_t>> results;
+    encoder.encode<E>(readings, results);
+    std::vector<uint8_t const*> buffers;
+    for (auto&& result : results) {
+      buffers.push_back(result.data());
+    }
+    encoder.encode<E>(readings, results);
+    for (size_t i = 0; i < results.size(); ++i) {
+      REQUIRE(results[i].data() == buffers[i]);
+    }
+  }
+
+  SECTION("an empty batch")
+  {
+    std::vector<std::vector<uint8_t>> results(3);
+    encoder.encode<E>(std::vector<Reading>{}, results);
+    REQUIRE(results.empty());
+  }
+
+  SECTION("a throwing message is rethrown once the batch is done")
+  {
+    std::vector<Faulty> faulties;
+    for (uint32_t i = 1; i < 1000; ++i) {
+      faulties.push_back({ i });
+    }
+    std::vector<std::vector<uint8_t>> results;
+    REQUIRE_THROWS_AS(encoder.encode<E>(faulties, results),
+                      std::runtime_error);
+    REQUIRE(results.size() == faulties.size());
+    xcdr2::VectorStreamEndian<E> expected{};
+    expected << faulties.back().value;
+    REQUIRE(results.back() == expected.buffer());
+
+    encoder.encode<E>(readings, results);
+    REQUIRE(results.size() == readings.size());
+  }
+}
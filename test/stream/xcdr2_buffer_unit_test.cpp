@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_buffer.hpp>
+#include <once/cpputils/stream/xcdr2_segmented_buffer.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::BufferStream",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  SECTION("padding is zeroed in reused storage")
+  {
+    xcdr2::Buffer buffer(64, 0xff);
+    buffer.clear();
+    xcdr2::BufferStreamEndian<E> stream{ std::move(buffer) };
+    stream << uint8_t{ 1 } << uint32_t{ 2 } << uint8_t{ 3 } << double{ 4 };
+
+    xcdr2::VectorStreamEndian<E> expected{};
+    expected << uint8_t{ 1 } << uint32_t{ 2 } << uint8_t{ 3 } << double{ 4 };
+    REQUIRE(std::vector<uint8_t>(stream.buffer().begin(),
+                                 stream.buffer().end()) == expected.buffer());
+  }
+
+  SECTION("sequences are decoded into reused storage")
+  {
+    std::vector<double> values{ 0.5, 1.5, 2.5, 3.5 };
+    std::vector<int16_t> shorts(100);
+    for (size_t i = 0; i < shorts.size(); ++i) {
+      shorts[i] = static_cast<int16_t>(i * 300);
+    }
+    xcdr2::BufferStreamEndian<E> stream{};
+    stream << values << std::string{ "between" } << shorts;
+
+    std::vector<double> deser_values(10, -1.0);
+    std::string deser_string(20, 'x');
+    std::vector<int16_t> deser_shorts(2);
+    stream >> deser_values >> deser_string >> deser_shorts;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_values == values);
+    REQUIRE(deser_string == "between");
+    REQUIRE(deser_shorts == shorts);
+  }
+
+  SECTION("split sequences are decoded")
+  {
+    std::vector<uint32_t> values(40);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<uint32_t>(i * 0x01010101);
+    }
+    std::string text(50, 't');
+    xcdr2::SegmentedStreamEndian<E, 16> stream{};
+    stream << uint8_t{ 1 } << values << text;
+
+    uint8_t first{};
+    std::vector<uint32_t> deser_values;
+    std::string deser_text;
+    stream >> first >> deser_values >> deser_text;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_values == values);
+    REQUIRE(deser_text == text);
+  }
+
+  SECTION("a truncated sequence is an error")
+  {
+    xcdr2::BufferStreamEndian<E> stream{};
+    stream << uint32_t{ 1000 } << double{ 1.0 };
+    std::vector<double> deser{ 2.0 };
+    stream >> deser;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(deser == std::vector<double>{ 2.0 });
+  }
+}
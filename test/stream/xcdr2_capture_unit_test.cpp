@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <once/cpputils/stream/xcdr2_capture.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace once::cpputils;
+
+TEST_CASE("xcdr2 captures")
+{
+  xcdr2::VectorStreamEndian<Endian::big> payload{};
+  payload << uint32_t{ 7 } << std::string{ "telemetry" };
+  const std::vector<xcdr2::CaptureRecord> records{
+    { 1000, 1, Endian::little, { 1, 2, 3 } },
+    { 2500, 2, Endian::big, payload.buffer() },
+    { 2600, 1, Endian::little, {} },
+  };
+
+  auto require_equal = [&records](
+                         std::vector<xcdr2::CaptureRecord> const& decoded) {
+    REQUIRE(decoded.size() == records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+      REQUIRE(decoded[i].timestamp == records[i].timestamp);
+      REQUIRE(decoded[i].type == records[i].type);
+      REQUIRE(decoded[i].endian == records[i].endian);
+      REQUIRE(decoded[i].payload == records[i].payload);
+    }
+  };
+
+  SECTION("round trip")
+  {
+    std::vector<xcdr2::CaptureRecord> decoded;
+    REQUIRE(xcdr2::decode_capture(xcdr2::encode_capture(records), decoded));
+    require_equal(decoded);
+  }
+
+  SECTION("round trip through a file")
+  {
+    char name[] = "/tmp/once_cpputils_capture_XXXXXX";
+    const int fd = ::mkstemp(name);
+    REQUIRE(-1 != fd);
+    ::close(fd);
+    std::vector<xcdr2::CaptureRecord> loaded;
+    REQUIRE(xcdr2::save_capture(name, records));
+    REQUIRE(xcdr2::load_capture(name, loaded));
+    ::unlink(name);
+    require_equal(loaded);
+    REQUIRE_FALSE(xcdr2::load_capture(name, loaded));
+  }
+
+  SECTION("rejects a bad magic")
+  {
+    std::vector<uint8_t> bytes = xcdr2::encode_capture(records);
+    bytes[0] ^= 0xff;
+    std::vector<xcdr2::CaptureRecord> decoded;
+    REQUIRE_FALSE(xcdr2::decode_capture(std::move(bytes), decoded));
+  }
+
+  SECTION("rejects an unknown endianness")
+  {
+    std::vector<uint8_t> bytes = xcdr2::encode_capture(records);
+    // Header, then the first record's timestamp and type.
+    const size_t endian = 12 + 8 + 4;
+    REQUIRE(bytes[endian] == 0);
+    bytes[endian] = 2;
+    std::vector<xcdr2::CaptureRecord> decoded;
+    REQUIRE_FALSE(xcdr2::decode_capture(std::move(bytes), decoded));
+  }
+
+  SECTION("rejects a truncated capture")
+  {
+    std::vector<uint8_t> bytes = xcdr2::encode_capture(records);
+    bytes.pop_back();
+    std::vector<xcdr2::CaptureRecord> decoded;
+    REQUIRE_FALSE(xcdr2::decode_capture(std::move(bytes), decoded));
+    REQUIRE(decoded.size() == 2);
+  }
+
+  SECTION("keeps only the whole records of a truncated capture")
+  {
+    std::vector<uint8_t> bytes = xcdr2::encode_capture(records);
+    // Header, the first record padded to 4, then the second one's timestamp,
+    // type, padded endianness and payload length.
+    const size_t second_payload = 12 + 24 + 8 + 4 + 4 + 4;
+    bytes.resize(second_payload + payload.buffer().size() / 2);
+    std::vector<xcdr2::CaptureRecord> decoded;
+    REQUIRE_FALSE(xcdr2::decode_capture(std::move(bytes), decoded));
+    REQUIRE(decoded.size() == 1);
+    REQUIRE(decoded[0].payload == records[0].payload);
+  }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_delta.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct State
+{
+  uint32_t mode;
+  double position;
+  double velocity;
+  std::string label;
+  std::vector<uint16_t> faults;
+
+  auto members() { return std::tie(mode, position, velocity, label, faults); }
+
+  auto members() const
+  {
+    return std::tie(mode, position, velocity, label, faults);
+  }
+};
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::delta",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  const State reference{ 2, 10.5, 0.25, "rover", { 3, 4 } };
+  State current = reference;
+  State replica = reference;
+
+  SECTION("an unchanged value only takes the bitmap")
+  {
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << xcdr2::delta(current.members(), reference.members());
+    REQUIRE(stream.ser_length() == sizeof(uint32_t));
+
+    stream >> xcdr2::patch(replica.members());
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(replica.members() == reference.members());
+  }
+
+  SECTION("only the changed members are encoded")
+  {
+    current.position = 11.0;
+    current.faults.push_back(5);
+
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << xcdr2::delta(current.members(), reference.members());
+
+    xcdr2::VectorStreamEndian<E> expected{};
+    expected << uint32_t{ 0x12 } << current.position << current.faults;
+    REQUIRE(stream.buffer() == expected.buffer());
+
+    stream >> xcdr2::patch(replica.members());
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(replica.members() == current.members());
+  }
+
+  SECTION("a truncated delta is an error")
+  {
+    current.label = "lander";
+
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << xcdr2::delta(current.members(), reference.members());
+    std::vector<uint8_t> truncated = stream.release();
+    truncated.resize(6);
+
+    xcdr2::VectorStreamEndian<E> short_stream{ std::move(truncated) };
+    short_stream >> xcdr2::patch(replica.members());
+    REQUIRE(short_stream.deser_state() == xcdr2::StreamState::error);
+  }
+}
+
+TEST_CASE("xcdr2::delta with more than 32 members")
+{
+  std::array<uint8_t, 40> reference{};
+  std::array<uint8_t, 40> current{};
+  current[1] = 1;
+  current[35] = 35;
+  auto tie = [](auto& a) {
+    return std::apply([](auto&... items) { return std::tie(items...); }, a);
+  };
+
+  xcdr2::VectorStream stream{};
+  stream << xcdr2::delta(tie(current), tie(reference));
+  REQUIRE(stream.ser_length() == 2 * sizeof(uint32_t) + 2);
+
+  std::array<uint8_t, 40> replica{};
+  stream >> xcdr2::patch(tie(replica));
+  REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+  REQUIRE(replica == current);
+}
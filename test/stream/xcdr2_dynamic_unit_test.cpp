@@ -0,0 +1,242 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_dynamic.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <stdexcept>
+
+using namespace once::cpputils;
+using namespace once::cpputils::xcdr2::dynamic;
+
+namespace {
+
+struct Point
+{
+  int32_t x;
+  int32_t y;
+  double z;
+};
+
+struct Sample
+{
+  int32_t a;
+  int32_t b;
+  double c;
+  uint8_t d;
+  std::string name;
+  std::vector<uint16_t> samples;
+  std::vector<Point> points;
+};
+
+TypeDescriptor
+point_type()
+{
+  return TypeDescriptor::structure(
+    sizeof(Point),
+    { { offsetof(Point, x), TypeDescriptor::primitive<int32_t>() },
+      { offsetof(Point, y), TypeDescriptor::primitive<int32_t>() },
+      { offsetof(Point, z), TypeDescriptor::primitive<double>() } });
+}
+
+TypeDescriptor
+sample_type()
+{
+  return TypeDescriptor::structure(
+    sizeof(Sample),
+    { { offsetof(Sample, a), TypeDescriptor::primitive<int32_t>() },
+      { offsetof(Sample, b), TypeDescriptor::primitive<int32_t>() },
+      { offsetof(Sample, c), TypeDescriptor::primitive<double>() },
+      { offsetof(Sample, d), TypeDescriptor::primitive<uint8_t>() },
+      { offsetof(Sample, name), TypeDescriptor::string() },
+      { offsetof(Sample, samples),
+        TypeDescriptor::sequence(TypeDescriptor::primitive<uint16_t>(),
+                                 vector_ops<uint16_t>()) },
+      { offsetof(Sample, points),
+        TypeDescriptor::sequence(point_type(), vector_ops<Point>()) } });
+}
+
+#pragma pack(push, 1)
+struct Tight
+{
+  uint32_t id;
+  uint8_t flags;
+};
+#pragma pack(pop)
+
+struct Tights
+{
+  std::vector<Tight> items;
+};
+
+TypeDescriptor
+tights_type()
+{
+  return TypeDescriptor::structure(
+    sizeof(Tights),
+    { { offsetof(Tights, items),
+        TypeDescriptor::sequence(
+          TypeDescriptor::structure(
+            sizeof(Tight),
+            { { offsetof(Tight, id), TypeDescriptor::primitive<uint32_t>() },
+              { offsetof(Tight, flags),
+                TypeDescriptor::primitive<uint8_t>() } }),
+          vector_ops<Tight>()) } });
+}
+
+struct Names
+{
+  std::vector<std::string> names;
+};
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::dynamic::Plan",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  Plan<E> plan{ sample_type() };
+  Sample sample{
+    1, 2, 3.5, 4, "dynamic", { 5, 6, 7 }, { { 8, 9, 10.5 }, { 11, 12, 13.5 } }
+  };
+
+  xcdr2::VectorStreamEndian<E> expected{};
+  expected << sample.a << sample.b << sample.c << sample.d << sample.name
+           << sample.samples;
+  expected << static_cast<uint32_t>(sample.points.size());
+  for (auto&& point : sample.points) {
+    expected << point.x << point.y << point.z;
+  }
+
+  SECTION("serializing with a plan matches the static encoding")
+  {
+    xcdr2::VectorStreamEndian<E> stream{};
+    serialize(stream, plan, &sample);
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::ok);
+    REQUIRE(stream.buffer() == expected.buffer());
+
+    SECTION("deserializing with a plan restores the image")
+    {
+      Sample deser{};
+      deserialize(stream, plan, &deser);
+      REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+      REQUIRE(stream.deser_length() == stream.ser_length());
+      REQUIRE(deser.a == sample.a);
+      REQUIRE(deser.b == sample.b);
+      REQUIRE(deser.c == sample.c);
+      REQUIRE(deser.d == sample.d);
+      REQUIRE(deser.name == sample.name);
+      REQUIRE(deser.samples == sample.samples);
+      REQUIRE(deser.points.size() == sample.points.size());
+      REQUIRE(deser.points[1].x == sample.points[1].x);
+      REQUIRE(deser.points[1].z == sample.points[1].z);
+    }
+  }
+
+  SECTION("deserializing a truncated buffer fails")
+  {
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << sample.a << sample.b;
+    Sample deser{};
+    deserialize(stream, plan, &deser);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+
+  SECTION("deserializing a truncated bulk sequence fails")
+  {
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << sample.a << sample.b << sample.c << sample.d << sample.name
+           << uint32_t{ 3 } << sample.samples[0];
+    Sample deser{};
+    deserialize(stream, plan, &deser);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+
+  SECTION("deserializing a corrupt sequence length fails without allocating")
+  {
+    const TypeDescriptor names_type = TypeDescriptor::structure(
+      sizeof(Names),
+      { { offsetof(Names, names),
+          TypeDescriptor::sequence(TypeDescriptor::string(),
+                                   vector_ops<std::string>()) } });
+    Plan<E> names_plan{ names_type };
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << uint32_t{ 0x10000000 } << std::string{};
+    Names deser{};
+    deserialize(stream, names_plan, &deser);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(deser.names.capacity() < 16);
+  }
+
+  SECTION("elements whose size breaks the stream alignment are not bulk")
+  {
+    Plan<E> tights_plan{ tights_type() };
+    REQUIRE_FALSE(tights_plan.instructions()[0].bulk);
+
+    Tights tights{ { { 1, 2 }, { 3, 4 } } };
+    xcdr2::VectorStreamEndian<E> stream{};
+    serialize(stream, tights_plan, &tights);
+    xcdr2::VectorStreamEndian<E> static_stream{};
+    static_stream << static_cast<uint32_t>(tights.items.size());
+    for (auto&& item : tights.items) {
+      // Copied out, since the packed members may be misaligned.
+      const uint32_t id = item.id;
+      const uint8_t flags = item.flags;
+      static_stream << id << flags;
+    }
+    REQUIRE(stream.buffer() == static_stream.buffer());
+    REQUIRE(stream.buffer().size() == 17);
+
+    Tights deser{};
+    deserialize(stream, tights_plan, &deser);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser.items.size() == 2);
+    const uint32_t id = deser.items[1].id;
+    const uint8_t flags = deser.items[1].flags;
+    REQUIRE(id == 3);
+    REQUIRE(flags == 4);
+  }
+}
+
+TEST_CASE("xcdr2::dynamic::TypeDescriptor rejects unsupported primitive sizes")
+{
+  for (size_t size : { 1, 2, 4, 8 }) {
+    REQUIRE(TypeDescriptor::primitive(size).size() == size);
+  }
+  for (size_t size : { 0, 3, 16 }) {
+    REQUIRE_THROWS_AS(TypeDescriptor::primitive(size), std::invalid_argument);
+  }
+}
+
+TEST_CASE("xcdr2::dynamic::Plan fuses memcpy-able members")
+{
+  Plan<Endian::native> plan{ sample_type() };
+  auto&& instructions = plan.instructions();
+
+  REQUIRE(instructions.size() == 6);
+  REQUIRE(instructions[0].code == OpCode::copy);
+  REQUIRE(instructions[0].size == 2 * sizeof(int32_t) + sizeof(double) + 1);
+  REQUIRE(instructions[1].code == OpCode::string);
+  REQUIRE(instructions[2].code == OpCode::sequence);
+  REQUIRE(instructions[2].bulk);
+  REQUIRE(instructions[4].code == OpCode::sequence);
+  REQUIRE(instructions[4].bulk);
+  REQUIRE(instructions[5].size == sizeof(Point));
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_fragment_cache.hpp>
+#include <once/cpputils/stream/xcdr2_graph.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Schema
+{
+  std::string name;
+  std::vector<std::string> fields;
+  double version;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Schema const& schema)
+{
+  return stream << schema.name << schema.fields << schema.version;
+}
+
+struct Channel
+{
+  uint32_t id;
+  once::reference<Schema> schema;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Channel const& channel)
+{
+  return stream << xcdr2::key(channel.id) << channel.schema->name;
+}
+
+struct Tag
+{
+  std::string label;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Tag const& tag)
+{
+  return stream << tag.label;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Tag& tag)
+{
+  return stream >> tag.label;
+}
+
+struct Tagged
+{
+  uint32_t id;
+  once::reference<Tag> tag;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Tagged const& tagged)
+{
+  return stream << tagged.id << tagged.tag;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Tagged& tagged)
+{
+  return stream >> tagged.id >> tagged.tag;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::FragmentCache",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  once::reference<Schema> schema{ "sensor",
+                                  std::vector<std::string>{ "id", "value" },
+                                  1.5 };
+  xcdr2::FragmentCache cache;
+
+  SECTION("splices the same bytes as encoding at every phase")
+  {
+    for (size_t phase = 0; phase < 8; ++phase) {
+      for (int repeat = 0; repeat < 2; ++repeat) {
+        xcdr2::VectorStreamEndian<E> stream{};
+        xcdr2::VectorStreamEndian<E> expected{};
+        for (size_t i = 0; i < phase; ++i) {
+          stream << uint8_t{ 1 };
+          expected << uint8_t{ 1 };
+        }
+        stream << cache.fragment(schema) << uint16_t{ 2 };
+        expected << *schema << uint16_t{ 2 };
+        REQUIRE(stream.buffer() == expected.buffer());
+      }
+    }
+    REQUIRE(cache.size() == 1);
+  }
+
+  SECTION("cached bytes are reused until erased")
+  {
+    xcdr2::VectorStreamEndian<E> before{};
+    before << cache.fragment(schema);
+    schema->version = 2.5;
+
+    xcdr2::VectorStreamEndian<E> cached{};
+    cached << cache.fragment(schema);
+    REQUIRE(cached.buffer() == before.buffer());
+
+    cache.erase(schema);
+    REQUIRE(cache.size() == 0);
+    xcdr2::VectorStreamEndian<E> refreshed{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    refreshed << cache.fragment(schema);
+    expected << *schema;
+    REQUIRE(refreshed.buffer() == expected.buffer());
+  }
+
+  SECTION("the cache keeps its targets alive")
+  {
+    {
+      once::reference<Schema> temporary{ "temporary",
+                                         std::vector<std::string>{},
+                                         0.0 };
+      xcdr2::VectorStreamEndian<E> stream{};
+      stream << cache.fragment(temporary);
+    }
+    once::reference<Schema> other{ "other", std::vector<std::string>{}, 0.0 };
+    xcdr2::VectorStreamEndian<E> stream{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    stream << cache.fragment(other);
+    expected << *other;
+    REQUIRE(stream.buffer() == expected.buffer());
+    REQUIRE(cache.size() == 2);
+  }
+
+  SECTION("a changed target is spliced as it was until erased")
+  {
+    xcdr2::VectorStreamEndian<E> before{};
+    before << cache.fragment(schema);
+    schema->name = "renamed";
+    schema->fields.push_back("unit");
+
+    xcdr2::VectorStreamEndian<E> stale{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    stale << cache.fragment(schema);
+    expected << *schema;
+    REQUIRE(stale.buffer() == before.buffer());
+    REQUIRE(stale.buffer() != expected.buffer());
+
+    cache.erase(schema);
+    xcdr2::VectorStreamEndian<E> refreshed{};
+    refreshed << cache.fragment(schema);
+    REQUIRE(refreshed.buffer() == expected.buffer());
+  }
+
+  SECTION("key-only streams bypass the cache")
+  {
+    once::reference<Channel> channel{ 7u, schema };
+    for (bool key : { false, true }) {
+      auto fragment = cache.fragment(channel);
+      xcdr2::VectorStreamEndian<E> stream{};
+      xcdr2::VectorStreamEndian<E> expected{};
+      stream.set_key_only(true);
+      expected.set_key_only(true);
+      if (key) {
+        stream << xcdr2::key(fragment);
+        expected << xcdr2::key(*channel);
+      } else {
+        stream << fragment;
+        expected << *channel;
+      }
+      REQUIRE(stream.buffer() == expected.buffer());
+    }
+    REQUIRE(cache.size() == 0);
+
+    xcdr2::VectorStreamEndian<E> full{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    full << cache.fragment(channel);
+    expected << *channel;
+    REQUIRE(full.buffer() == expected.buffer());
+    REQUIRE(cache.size() == 1);
+  }
+
+  SECTION("streams in graph mode bypass the cache")
+  {
+    once::reference<Tag> tag{ "shared" };
+    once::reference<Tagged> first{ 1u, tag };
+    once::reference<Tagged> second{ 2u, tag };
+    xcdr2::Graph graph;
+    xcdr2::VectorStreamEndian<E> stream{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    stream.set_graph(&graph);
+    stream << cache.fragment(first) << cache.fragment(second);
+    graph.clear();
+    expected.set_graph(&graph);
+    expected << *first << *second;
+    REQUIRE(stream.buffer() == expected.buffer());
+    REQUIRE(cache.size() == 0);
+
+    xcdr2::Graph deser_graph;
+    stream.set_graph(&deser_graph);
+    Tagged deser_first;
+    Tagged deser_second;
+    stream >> deser_first >> deser_second;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_second.id == 2);
+    REQUIRE(deser_second.tag->label == "shared");
+    REQUIRE(&deser_first.tag.get() == &deser_second.tag.get());
+  }
+}
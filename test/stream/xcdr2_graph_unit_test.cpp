@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_graph.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Material
+{
+  std::string name;
+  std::array<float, 4> color;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Material const& material)
+{
+  return stream << material.name << material.color;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Material& material)
+{
+  return stream >> material.name >> material.color;
+}
+
+struct Node
+{
+  uint32_t id;
+  once::reference<Material> material;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Node const& node)
+{
+  return stream << node.id << node.material;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Node& node)
+{
+  return stream >> node.id >> node.material;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Graph",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  const std::array<float, 4> gray{ 0.5f, 0.5f, 0.5f, 1 };
+  const std::array<float, 4> green{ 0, 1, 0, 1 };
+  once::reference<Material> stone{ "stone", gray };
+  once::reference<Material> grass{ "grass", green };
+  std::vector<Node> nodes;
+  for (uint32_t i = 0; i < 100; ++i) {
+    nodes.push_back({ i, (0 == i % 3) ? grass : stone });
+  }
+
+  SECTION("shared targets are encoded once")
+  {
+    xcdr2::Graph graph;
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream.set_graph(&graph);
+    stream << nodes;
+    REQUIRE(graph.size() == 2);
+
+    xcdr2::VectorStreamEndian<E> plain{};
+    plain << nodes;
+    REQUIRE(stream.ser_length() < plain.ser_length() / 3);
+
+    xcdr2::Graph deser_graph;
+    stream.set_graph(&deser_graph);
+    std::vector<Node> deser;
+    stream >> deser;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_graph.size() == 2);
+    REQUIRE(deser.size() == nodes.size());
+    REQUIRE(deser[0].material->name == "grass");
+    REQUIRE(deser[1].material->name == "stone");
+    REQUIRE(deser[1].material->color == stone->color);
+    REQUIRE(&deser[0].material.get() == &deser[99].material.get());
+    REQUIRE(&deser[1].material.get() == &deser[2].material.get());
+    REQUIRE(&deser[0].material.get() != &deser[1].material.get());
+  }
+
+  SECTION("without a graph every target is encoded")
+  {
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << nodes;
+    std::vector<Node> deser;
+    stream >> deser;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser[4].material->name == "stone");
+    REQUIRE(&deser[1].material.get() != &deser[2].material.get());
+  }
+
+  SECTION("an unknown back-reference is an error")
+  {
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream << uint32_t{ 7 } << uint32_t{ 1 };
+    xcdr2::Graph graph;
+    stream.set_graph(&graph);
+    Node deser{ 0, stone };
+    stream >> deser;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(&deser.material.get() == &stone.get());
+  }
+
+  SECTION("a back-reference to another type is an error")
+  {
+    once::reference<uint32_t> number{ 5u };
+    xcdr2::Graph graph;
+    xcdr2::VectorStreamEndian<E> stream{};
+    stream.set_graph(&graph);
+    stream << number << uint32_t{ 1 } << uint32_t{ 1 };
+
+    xcdr2::Graph deser_graph;
+    stream.set_graph(&deser_graph);
+    once::reference<uint32_t> deser_number{ 0u };
+    Node deser{ 0, stone };
+    stream >> deser_number >> deser;
+    REQUIRE(*deser_number == 5);
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_key_hash.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Sensor
+{
+  uint32_t id;
+  std::string location;
+  double value;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Sensor const& sensor)
+{
+  return stream << xcdr2::key(sensor.id) << sensor.location << sensor.value;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Sensor& sensor)
+{
+  return stream >> xcdr2::key(sensor.id) >> sensor.location >> sensor.value;
+}
+
+struct Route
+{
+  std::string origin;
+  std::string destination;
+  uint16_t hops;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Route const& route)
+{
+  return stream << xcdr2::key(route.origin) << xcdr2::key(route.destination)
+                << route.hops;
+}
+
+} // namespace
+
+TEST_CASE("xcdr2::Stream in key-only mode")
+{
+  Sensor sensor{ 0x01020304, "kitchen", 21.5 };
+
+  SECTION("serializes every member by default")
+  {
+    xcdr2::VectorStream stream{};
+    stream << sensor;
+    REQUIRE(stream.ser_length() == 4 + 4 + 7 + 1 + 8);
+
+    Sensor deser{};
+    stream >> deser;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser.id == sensor.id);
+    REQUIRE(deser.location == sensor.location);
+  }
+
+  SECTION("serializes only the key members")
+  {
+    xcdr2::VectorStreamEndian<Endian::big> stream{};
+    stream.set_key_only(true);
+    stream << sensor;
+    REQUIRE(stream.buffer() == std::vector<uint8_t>{ 0x01, 0x02, 0x03, 0x04 });
+  }
+}
+
+TEST_CASE("xcdr2::key_hash")
+{
+  SECTION("a key that fits is zero padded")
+  {
+    Sensor sensor{ 0x01020304, "kitchen", 21.5 };
+    xcdr2::KeyHash expected{ 0x01, 0x02, 0x03, 0x04 };
+    REQUIRE(xcdr2::key_hash(sensor) == expected);
+  }
+
+  SECTION("a key that does not fit is hashed with md5")
+  {
+    Route route{ "Santiago de Compostela", "A Coruña", 3 };
+    auto bytes = xcdr2::key_bytes(route);
+    REQUIRE(bytes.size() > sizeof(xcdr2::KeyHash));
+    REQUIRE(xcdr2::key_hash(route) ==
+            md5::compute(bytes.data(), bytes.size()));
+  }
+
+  SECTION("string keys are hashed with their terminating nul")
+  {
+    Route route{ "A", "B", 1 };
+    REQUIRE(xcdr2::key_bytes(route) ==
+            std::vector<uint8_t>{
+              0, 0, 0, 2, 'A', 0, 0, 0, 0, 0, 0, 2, 'B', 0 });
+    xcdr2::KeyHash expected{ 0xa0, 0x07, 0x4d, 0xc2, 0x28, 0x83, 0x5a, 0x0f,
+                             0x41, 0x8f, 0xdd, 0xf4, 0x43, 0x59, 0x51, 0xbe };
+    REQUIRE(xcdr2::key_hash(route, xcdr2::KeyHashMode::md5) == expected);
+  }
+
+  SECTION("md5 can be forced for unbounded keys")
+  {
+    Route route{ "A", "B", 1 };
+    auto bytes = xcdr2::key_bytes(route);
+    REQUIRE(xcdr2::key_hash(route, xcdr2::KeyHashMode::md5) ==
+            md5::compute(bytes.data(), bytes.size()));
+  }
+}
+
+TEST_CASE("xcdr2::fast_key_hash")
+{
+  Sensor lhs{ 7, "kitchen", 21.5 };
+  Sensor rhs{ 7, "garage", -3.0 };
+  Sensor other{ 8, "kitchen", 21.5 };
+
+  REQUIRE(xcdr2::fast_key_hash(lhs) == xcdr2::fast_key_hash(rhs));
+  REQUIRE(xcdr2::fast_key_hash(lhs) != xcdr2::fast_key_hash(other));
+
+  Route short_route{ "A", "B", 1 };
+  Route long_route{ "Santiago de Compostela", "A Coruña", 1 };
+  REQUIRE(xcdr2::fast_key_hash(short_route) !=
+          xcdr2::fast_key_hash(long_route));
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_graph.hpp>
+#include <once/cpputils/stream/xcdr2_lazy.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Payload
+{
+  std::string topic;
+  std::vector<double> values;
+  uint8_t flags;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Payload const& payload)
+{
+  return stream << payload.topic << payload.values << payload.flags;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Payload& payload)
+{
+  return stream >> payload.topic >> payload.values >> payload.flags;
+}
+
+struct Envelope
+{
+  uint16_t destination;
+  xcdr2::Lazy<Payload> payload;
+  uint32_t sequence_number;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Envelope const& envelope)
+{
+  return stream << envelope.destination << envelope.payload
+                << envelope.sequence_number;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Envelope& envelope)
+{
+  return stream >> envelope.destination >> envelope.payload >>
+         envelope.sequence_number;
+}
+
+struct Keyed
+{
+  uint16_t id;
+  xcdr2::Lazy<Payload> payload;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Keyed const& keyed)
+{
+  return stream << xcdr2::key(keyed.id) << keyed.payload;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Lazy",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  Envelope envelope{
+    7, Payload{ "sensors/kitchen", { 0.5, 1.5, 2.5 }, 3 }, 42
+  };
+  xcdr2::VectorStreamEndian<E> stream{};
+  stream << envelope;
+
+  Envelope deser{};
+  stream >> deser;
+  REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+  REQUIRE(deser.destination == 7);
+  REQUIRE(deser.sequence_number == 42);
+
+  SECTION("is not decoded until accessed")
+  {
+    REQUIRE_FALSE(deser.payload.materialized());
+    REQUIRE(deser.payload->topic == "sensors/kitchen");
+    REQUIRE(deser.payload->values == std::vector<double>{ 0.5, 1.5, 2.5 });
+    REQUIRE(deser.payload->flags == 3);
+    REQUIRE(deser.payload.materialized());
+    REQUIRE(deser.payload.deser_state() == xcdr2::StreamState::ok);
+  }
+
+  SECTION("is forwarded untouched")
+  {
+    xcdr2::VectorStreamEndian<E> forwarded{};
+    forwarded << deser;
+    REQUIRE_FALSE(deser.payload.materialized());
+    REQUIRE(forwarded.buffer() == stream.buffer());
+  }
+
+  SECTION("is encoded again once modified")
+  {
+    deser.payload->values.push_back(3.5);
+    envelope.payload->values.push_back(3.5);
+
+    xcdr2::VectorStreamEndian<E> modified{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    modified << deser;
+    expected << envelope;
+    REQUIRE(modified.buffer() == expected.buffer());
+  }
+
+  SECTION("is encoded again for the other endianness")
+  {
+    constexpr Endian other =
+      (Endian::little == E) ? Endian::big : Endian::little;
+    xcdr2::VectorStreamEndian<other> forwarded{};
+    xcdr2::VectorStreamEndian<other> expected{};
+    forwarded << deser;
+    expected << envelope;
+    REQUIRE(forwarded.buffer() == expected.buffer());
+  }
+
+  SECTION("fails on a truncated buffer")
+  {
+    std::vector<uint8_t> truncated = stream.buffer();
+    truncated.resize(8);
+    xcdr2::VectorStreamEndian<E> short_stream{ std::move(truncated) };
+    Envelope partial{};
+    short_stream >> partial;
+    REQUIRE(short_stream.deser_state() == xcdr2::StreamState::error);
+  }
+
+  SECTION("rejects a corrupt length without altering the member")
+  {
+    xcdr2::Lazy<Payload> lazy{ envelope.payload.get() };
+    xcdr2::VectorStreamEndian<E> corrupt{};
+    corrupt << uint32_t{ 0xf0000000 } << uint32_t{ 0 };
+    corrupt >> lazy;
+    REQUIRE(corrupt.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(corrupt.deser_length() == 4);
+    REQUIRE(lazy.materialized());
+    REQUIRE(lazy->topic == "sensors/kitchen");
+  }
+
+  SECTION("is decoded and encoded once by concurrent const readers")
+  {
+    Envelope const& shared = deser;
+    std::vector<std::vector<uint8_t>> encoded(4);
+    std::vector<std::string> topics(4);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < encoded.size(); ++i) {
+      readers.emplace_back([&shared, &encoded, &topics, i]() {
+        // Half of them access the value first, half serialize it first.
+        xcdr2::VectorStreamEndian<E> forwarded{};
+        if (0 == i % 2) {
+          topics[i] = shared.payload->topic;
+          forwarded << shared;
+        } else {
+          forwarded << shared;
+          topics[i] = shared.payload->topic;
+        }
+        encoded[i] = forwarded.buffer();
+      });
+    }
+    for (auto&& reader : readers) {
+      reader.join();
+    }
+    REQUIRE(deser.payload.materialized());
+    REQUIRE(deser.payload.deser_state() == xcdr2::StreamState::ok);
+    for (size_t i = 0; i < encoded.size(); ++i) {
+      REQUIRE(encoded[i] == stream.buffer());
+      REQUIRE(topics[i] == "sensors/kitchen");
+    }
+  }
+
+  SECTION("is copied with its retained bytes")
+  {
+    Envelope copy = deser;
+    REQUIRE_FALSE(copy.payload.materialized());
+    xcdr2::VectorStreamEndian<E> forwarded{};
+    forwarded << copy;
+    REQUIRE(forwarded.buffer() == stream.buffer());
+    REQUIRE(copy.payload->flags == 3);
+  }
+
+  SECTION("is skipped without decoding by key-only streams")
+  {
+    Keyed keyed{ 5, {} };
+    xcdr2::VectorStreamEndian<E> payload_stream{};
+    payload_stream << deser.payload;
+    payload_stream >> keyed.payload;
+    REQUIRE_FALSE(keyed.payload.materialized());
+
+    xcdr2::VectorStreamEndian<E> key_stream{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    key_stream.set_key_only(true);
+    key_stream << keyed;
+    expected << uint16_t{ 5 };
+    REQUIRE(key_stream.buffer() == expected.buffer());
+    REQUIRE_FALSE(keyed.payload.materialized());
+  }
+
+  SECTION("is encoded as a plain value in graph mode")
+  {
+    once::reference<Payload> shared{ "shared",
+                                     std::vector<double>{ 1 },
+                                     uint8_t{ 0 } };
+    xcdr2::Lazy<once::reference<Payload>> first{ shared };
+    xcdr2::Lazy<once::reference<Payload>> second{ shared };
+    xcdr2::Graph graph;
+    xcdr2::VectorStreamEndian<E> graph_stream{};
+    xcdr2::VectorStreamEndian<E> expected{};
+    graph_stream.set_graph(&graph);
+    graph_stream << first << second;
+    graph.clear();
+    expected.set_graph(&graph);
+    expected << shared << shared;
+    REQUIRE(graph_stream.buffer() == expected.buffer());
+
+    xcdr2::Graph deser_graph;
+    graph_stream.set_graph(&deser_graph);
+    xcdr2::Lazy<once::reference<Payload>> deser_first;
+    xcdr2::Lazy<once::reference<Payload>> deser_second;
+    graph_stream >> deser_first >> deser_second;
+    REQUIRE(graph_stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(deser_first.materialized());
+    REQUIRE((*deser_second)->topic == "shared");
+    REQUIRE(&deser_first->get() == &deser_second->get());
+  }
+}
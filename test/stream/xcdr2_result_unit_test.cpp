@@ -0,0 +1,122 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <once/cpputils/stream/xcdr2_result.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Record
+{
+  uint32_t id;
+  std::string name;
+  std::vector<std::string> tags;
+  double value;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Record const& record)
+{
+  return stream << record.id << record.name << record.tags << record.value;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Record& record)
+{
+  return stream >> record.id >> record.name >> record.tags >> record.value;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::decode",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  const Record record{ 7, "sensor", { "a", "bb", "ccc" }, 2.5 };
+  xcdr2::Stream<E, std::vector<uint8_t>> stream{};
+  stream << record << record;
+  const std::vector<uint8_t> bytes = stream.buffer();
+
+  SECTION("returns the decoded values")
+  {
+    xcdr2::Stream<E, std::vector<uint8_t>> input{ std::vector<uint8_t>{
+      bytes } };
+    for (int i = 0; i < 2; ++i) {
+      auto decoded = xcdr2::decode<Record>(input);
+      REQUIRE(decoded.is_ok());
+      REQUIRE(decoded.ok().id == record.id);
+      REQUIRE(decoded.ok().name == record.name);
+      REQUIRE(decoded.ok().tags == record.tags);
+      REQUIRE(decoded.ok().value == record.value);
+    }
+    REQUIRE(xcdr2::decode<uint8_t>(input).is_error_and(
+      xcdr2::DecodeError{ bytes.size() }));
+  }
+
+  SECTION("stops at the first error")
+  {
+    // The name length of the first record, pointing past the end.
+    std::vector<uint8_t> corrupt{ bytes };
+    corrupt[4] = corrupt[5] = corrupt[6] = corrupt[7] = 0xff;
+    auto decoded = xcdr2::decode<Record, E>(corrupt);
+    REQUIRE(decoded.is_error_and(xcdr2::DecodeError{ 8 }));
+
+    xcdr2::Stream<E, std::vector<uint8_t>> input{ std::move(corrupt) };
+    Record target{};
+    input >> target;
+    REQUIRE(input.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(input.deser_length() == 8);
+    uint32_t next{};
+    input >> next;
+    REQUIRE(input.deser_length() == 8);
+  }
+
+  SECTION("does not allocate a corrupt sequence length upfront")
+  {
+    std::vector<uint8_t> corrupt{ bytes };
+    // The tag count of the first record.
+    const size_t tags = 4 + 4 + record.name.size() + 2;
+    corrupt[tags] = corrupt[tags + 1] = corrupt[tags + 2] = 0x7f;
+    xcdr2::Stream<E, std::vector<uint8_t>> input{ std::move(corrupt) };
+    Record target{};
+    input >> target;
+    REQUIRE(input.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(target.tags.capacity() <= 2 * bytes.size() / 4);
+  }
+
+  SECTION("verifies the trailer of a whole message")
+  {
+    xcdr2::Stream<E, std::vector<uint8_t>> sealed{};
+    sealed.set_trailer(xcdr2::Trailer::crc32c);
+    sealed << record;
+    sealed.seal();
+    std::vector<uint8_t> message = sealed.release();
+    REQUIRE(
+      xcdr2::decode<Record, E>(message, xcdr2::Trailer::crc32c).is_ok());
+    message.back() ^= 0x01;
+    REQUIRE(
+      xcdr2::decode<Record, E>(message, xcdr2::Trailer::crc32c).is_error());
+  }
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_segmented_buffer.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::SegmentedStream",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  xcdr2::SegmentedStreamEndian<E, 16> stream{};
+  xcdr2::VectorStreamEndian<E> expected{};
+
+  std::vector<bool> flags{ true, false, true, true, false };
+  std::vector<double> values{ 0.5, -1.5, 2.5, 1e10, -1e-10 };
+  auto serialize = [&](auto& s) {
+    s << uint8_t{ 1 } << uint16_t{ 2 } << uint32_t{ 3 } << int64_t{ -4 }
+      << double{ 5.5 } << std::string{ "straddling the slabs" } << values
+      << flags << xcdr2::packed(flags) << std::array<uint16_t, 3>{ 7, 8, 9 };
+  };
+  serialize(stream);
+  serialize(expected);
+
+  SECTION("serializing matches the vector backend")
+  {
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::ok);
+    REQUIRE(stream.ser_length() == expected.ser_length());
+    REQUIRE(stream.buffer().size() == expected.ser_length());
+    REQUIRE(stream.buffer().slab_count() ==
+            (expected.ser_length() + 15) / 16);
+    REQUIRE(stream.buffer().flatten() == expected.buffer());
+  }
+
+  SECTION("deserializing values straddling slab boundaries")
+  {
+    uint8_t u8;
+    uint16_t u16;
+    uint32_t u32;
+    int64_t i64;
+    double f64;
+    std::string text;
+    std::vector<double> deser_values;
+    std::vector<bool> deser_flags;
+    std::vector<bool> deser_packed;
+    std::array<uint16_t, 3> deser_array;
+    stream >> u8 >> u16 >> u32 >> i64 >> f64 >> text >> deser_values >>
+      deser_flags >> xcdr2::packed(deser_packed) >> deser_array;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(stream.deser_length() == stream.ser_length());
+    REQUIRE(u8 == 1);
+    REQUIRE(u16 == 2);
+    REQUIRE(u32 == 3);
+    REQUIRE(i64 == -4);
+    REQUIRE(f64 == 5.5);
+    REQUIRE(text == "straddling the slabs");
+    REQUIRE(deser_values == values);
+    REQUIRE(deser_flags == flags);
+    REQUIRE(deser_packed == flags);
+    REQUIRE(deser_array == std::array<uint16_t, 3>{ 7, 8, 9 });
+
+    uint8_t extra;
+    stream >> extra;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::error);
+  }
+
+  SECTION("exporting the segments")
+  {
+    size_t total = 0;
+    for (auto&& segment : stream.buffer().segments()) {
+      REQUIRE(segment.size <= 16);
+      total += segment.size;
+    }
+    REQUIRE(total == stream.ser_length());
+    REQUIRE(stream.buffer().iovecs().size() == stream.buffer().slab_count());
+  }
+
+  SECTION("releasing the buffer")
+  {
+    auto buffer = stream.release();
+    REQUIRE(buffer.flatten() == expected.buffer());
+    REQUIRE(0 == stream.ser_length());
+    REQUIRE(stream.buffer().empty());
+  }
+}
+
+TEST_CASE("xcdr2::SegmentedBuffer never moves written bytes")
+{
+  xcdr2::SegmentedStream stream{};
+  stream << uint32_t{ 0xCAFE };
+  auto first = stream.buffer().segments().front().data;
+  std::vector<uint8_t> payload(1 << 20, 0xAB);
+  stream.write(payload.data(), payload.size());
+  REQUIRE(stream.buffer().segments().front().data == first);
+  REQUIRE(stream.buffer().slab_count() ==
+          (sizeof(uint32_t) + payload.size()) / (64 * 1024) + 1);
+}
+
+TEST_CASE("xcdr2::SegmentedStream with a CRC32C trailer")
+{
+  xcdr2::SegmentedStreamEndian<Endian::native, 64> stream{};
+  xcdr2::VectorStream expected{};
+  stream.set_trailer(xcdr2::Trailer::crc32c);
+  expected.set_trailer(xcdr2::Trailer::crc32c);
+  std::vector<uint32_t> values(3000, 0x01020304);
+  stream << values;
+  expected << values;
+  stream.seal();
+  expected.seal();
+  REQUIRE(stream.buffer().flatten() == expected.buffer());
+
+  std::vector<uint32_t> deser_values;
+  stream >> deser_values;
+  REQUIRE(deser_values == values);
+  REQUIRE(stream.verify());
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_sequence_view.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <numeric>
+
+using namespace once::cpputils;
+
+namespace {
+
+struct Trade
+{
+  std::string symbol;
+  uint32_t quantity;
+  double price;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Trade const& trade)
+{
+  return stream << trade.symbol << trade.quantity << trade.price;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Trade& trade)
+{
+  return stream >> trade.symbol >> trade.quantity >> trade.price;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::SequenceView",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  std::vector<Trade> trades;
+  for (uint32_t i = 0; i < 50; ++i) {
+    trades.push_back({ (0 == i % 2) ? "ACME" : "INITECH", i, 1.5 * i });
+  }
+  xcdr2::VectorStreamEndian<E> stream{};
+  stream << trades << uint16_t{ 0xabcd };
+
+  SECTION("decodes the elements while iterating")
+  {
+    auto view = xcdr2::sequence_view<Trade>(stream);
+    REQUIRE(view.size() == trades.size());
+    Trade const* element = nullptr;
+    uint32_t count = 0;
+    for (auto&& trade : view) {
+      if (nullptr == element) {
+        element = &trade;
+      }
+      REQUIRE(&trade == element);
+      REQUIRE(trade.symbol == trades[count].symbol);
+      ++count;
+    }
+    REQUIRE(count == trades.size());
+
+    uint16_t trailer{};
+    stream >> trailer;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(trailer == 0xabcd);
+  }
+
+  SECTION("folds over the elements")
+  {
+    auto view = xcdr2::sequence_view<Trade>(stream);
+    const double notional = std::accumulate(
+      view.begin(), view.end(), 0.0, [](double sum, Trade const& trade) {
+        return sum + trade.quantity * trade.price;
+      });
+    const double expected = std::accumulate(
+      trades.begin(), trades.end(), 0.0, [](double sum, Trade const& trade) {
+        return sum + trade.quantity * trade.price;
+      });
+    REQUIRE(notional == expected);
+  }
+
+  SECTION("finishing skips the rest")
+  {
+    auto view = xcdr2::sequence_view<Trade>(stream);
+    auto it = view.begin();
+    ++it;
+    REQUIRE(it->quantity == 1);
+    REQUIRE(view.position() == 2);
+
+    uint16_t trailer{};
+    view.finish() >> trailer;
+    REQUIRE(view.position() == trades.size());
+    REQUIRE(trailer == 0xabcd);
+  }
+
+  SECTION("an error ends the iteration")
+  {
+    std::vector<uint8_t> truncated = stream.release();
+    truncated.resize(40);
+    xcdr2::VectorStreamEndian<E> short_stream{ std::move(truncated) };
+    auto view = xcdr2::sequence_view<Trade>(short_stream);
+    size_t count = 0;
+    for (auto it = view.begin(); it != view.end(); ++it) {
+      ++count;
+    }
+    REQUIRE(count < trades.size());
+    REQUIRE(short_stream.deser_state() == xcdr2::StreamState::error);
+  }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_shared_buffer.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::Reader",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  xcdr2::VectorStreamEndian<E> stream{};
+  stream << uint16_t{ 1 } << std::string{ "shared" }
+         << std::vector<int32_t>{ 2, 3, 4 } << double{ 5.5 };
+  const size_t values_offset = 4 + 4 + 7 + 1;
+  const xcdr2::SharedBuffer buffer{ stream.release() };
+
+  SECTION("readers share the bytes")
+  {
+    auto first = xcdr2::reader<E>(buffer);
+    auto second = xcdr2::reader<E>(buffer);
+    REQUIRE(buffer.use_count() == 3);
+    REQUIRE(first.buffer().data() == second.buffer().data());
+  }
+
+  SECTION("readers keep their own position and state")
+  {
+    auto first = xcdr2::reader<E>(buffer);
+    auto second = xcdr2::reader<E>(buffer);
+
+    uint16_t a{};
+    std::string b;
+    first >> a;
+    second >> a >> b;
+    REQUIRE(first.deser_length() == 2);
+    REQUIRE(b == "shared");
+
+    std::vector<int32_t> c;
+    double d{};
+    first >> b >> c >> d;
+    REQUIRE(first.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(d == 5.5);
+
+    first >> d;
+    REQUIRE(first.deser_state() == xcdr2::StreamState::error);
+    REQUIRE(second.deser_state() == xcdr2::StreamState::ok);
+  }
+
+  SECTION("a reader can start at a known offset")
+  {
+    auto reader = xcdr2::reader<E>(buffer);
+    xcdr2::Span<int32_t> values;
+    reader.seek(values_offset) >> values;
+    REQUIRE(reader.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(std::vector<int32_t>(values.begin(), values.end()) ==
+            std::vector<int32_t>{ 2, 3, 4 });
+    REQUIRE(values.borrowed() == (E == Endian::native));
+
+    reader.seek(buffer.size() + 1);
+    REQUIRE(reader.deser_state() == xcdr2::StreamState::error);
+  }
+}
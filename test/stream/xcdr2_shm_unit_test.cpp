@@ -0,0 +1,208 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <once/cpputils/stream/xcdr2_shm.hpp>
+
+#include <catch2/catch.hpp>
+
+using namespace once::cpputils;
+
+#ifdef ONCE__CPPUTILS__XCDR2_SHM
+
+#include <sys/wait.h>
+
+namespace {
+
+std::string
+segment_name(char const* suffix)
+{
+  return "/once_cpputils_xcdr2_" + std::to_string(::getpid()) + "_" + suffix;
+}
+
+} // namespace
+
+TEST_CASE("xcdr2::ShmSegment")
+{
+  const std::string name = segment_name("unit_test");
+  xcdr2::ShmSegment::unlink(name);
+  xcdr2::ShmSegment writer_segment = xcdr2::ShmSegment::create(name, 2, 256);
+  xcdr2::ShmSegment reader_segment = xcdr2::ShmSegment::open(name);
+  xcdr2::ShmSegment::unlink(name);
+  REQUIRE(writer_segment.valid());
+  REQUIRE(reader_segment.valid());
+  REQUIRE(reader_segment.slot_count() == 2);
+  REQUIRE(reader_segment.slot_size() == 256);
+
+  SECTION("a published slot is decoded in place by another mapping")
+  {
+    xcdr2::ShmWriter writer{ writer_segment.acquire() };
+    writer << std::string{ "zero copy" } << std::vector<uint32_t>{ 1, 2, 3 };
+    REQUIRE(writer_segment.publish(writer.release()));
+
+    xcdr2::ShmSlotView view = reader_segment.take();
+    REQUIRE(view.valid());
+    uint8_t const* slot_data = view.data();
+    xcdr2::ShmReader reader{ std::move(view) };
+    std::string text;
+    xcdr2::Span<uint32_t> values;
+    reader >> text >> values;
+    REQUIRE(reader.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(text == "zero copy");
+    REQUIRE(values.borrowed());
+    REQUIRE(static_cast<void const*>(values.data()) ==
+            static_cast<void const*>(slot_data + 20));
+    REQUIRE(values[2] == 3);
+
+    reader_segment.release(reader.release());
+    REQUIRE_FALSE(reader_segment.take().valid());
+  }
+
+  SECTION("slots are taken in publication order")
+  {
+    xcdr2::ShmSlotBuffer first = writer_segment.acquire();
+    xcdr2::ShmSlotBuffer second = writer_segment.acquire();
+    REQUIRE(first.valid());
+    REQUIRE(second.valid());
+    REQUIRE_FALSE(writer_segment.acquire().valid());
+
+    xcdr2::ShmWriter writer{ std::move(second) };
+    writer << uint32_t{ 1 };
+    REQUIRE(writer_segment.publish(writer.release()));
+    writer.adopt(std::move(first));
+    writer << uint32_t{ 2 };
+    REQUIRE(writer_segment.publish(writer.release()));
+
+    for (uint32_t expected : { 1, 2 }) {
+      xcdr2::ShmReader reader{ reader_segment.take() };
+      uint32_t value{};
+      reader >> value;
+      REQUIRE(value == expected);
+      reader_segment.release(reader.release());
+    }
+    REQUIRE(writer_segment.acquire().valid());
+  }
+
+  SECTION("an overflowed slot is not published")
+  {
+    xcdr2::ShmWriter writer{ writer_segment.acquire() };
+    writer.set_trailer(xcdr2::Trailer::crc32c);
+    writer << std::vector<uint64_t>(64, 0) << std::vector<uint8_t>(8192, 0);
+    writer.seal();
+    REQUIRE(writer.ser_state() == xcdr2::StreamState::error);
+    REQUIRE(writer.ser_length() == writer.buffer().size());
+    REQUIRE(writer.ser_length() <= writer.buffer().capacity());
+    REQUIRE(writer.buffer().overflowed());
+    REQUIRE_FALSE(writer_segment.publish(writer.release()));
+    REQUIRE_FALSE(reader_segment.take().valid());
+    REQUIRE(writer_segment.acquire().valid());
+    REQUIRE(writer_segment.acquire().valid());
+  }
+
+  SECTION("a dropped buffer or view frees its slot")
+  {
+    {
+      xcdr2::ShmWriter writer{ writer_segment.acquire() };
+      REQUIRE(writer.buffer().valid());
+      writer << uint32_t{ 1 };
+      xcdr2::ShmSlotBuffer other = writer_segment.acquire();
+      REQUIRE(other.valid());
+      REQUIRE_FALSE(writer_segment.acquire().valid());
+    }
+    xcdr2::ShmWriter writer{ writer_segment.acquire() };
+    writer << uint32_t{ 2 };
+    REQUIRE(writer_segment.publish(writer.release()));
+    {
+      xcdr2::ShmReader reader{ reader_segment.take() };
+      REQUIRE(reader.buffer().valid());
+    }
+    REQUIRE_FALSE(reader_segment.take().valid());
+    REQUIRE(writer_segment.acquire().valid());
+    REQUIRE(writer_segment.acquire().valid());
+  }
+}
+
+TEST_CASE("xcdr2::ShmSegment across processes")
+{
+  const std::string name = segment_name("processes");
+  xcdr2::ShmSegment::unlink(name);
+  xcdr2::ShmSegment segment = xcdr2::ShmSegment::create(name, 4, 64);
+  REQUIRE(segment.valid());
+
+  const pid_t pid = ::fork();
+  REQUIRE(-1 != pid);
+  if (0 == pid) {
+    xcdr2::ShmSegment child = xcdr2::ShmSegment::open(name);
+    xcdr2::ShmWriterEndian<Endian::big> writer{ child.acquire() };
+    writer << uint16_t{ 0x0102 } << std::string{ "from the child" };
+    ::_exit(child.publish(writer.release()) ? 0 : 1);
+  }
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+  xcdr2::ShmSegment::unlink(name);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(0 == WEXITSTATUS(status));
+
+  xcdr2::ShmReaderEndian<Endian::big> reader{ segment.take() };
+  uint16_t value{};
+  std::string text;
+  reader >> value >> text;
+  REQUIRE(reader.deser_state() == xcdr2::StreamState::ok);
+  REQUIRE(value == 0x0102);
+  REQUIRE(text == "from the child");
+}
+
+#ifdef MFD_CLOEXEC
+TEST_CASE("xcdr2::ShmSegment without a name")
+{
+  xcdr2::ShmSegment segment = xcdr2::ShmSegment::create_anonymous(1, 32);
+  REQUIRE(segment.valid());
+  xcdr2::ShmSegment other = xcdr2::ShmSegment::open(::dup(segment.fd()));
+  REQUIRE(other.valid());
+  REQUIRE(other.slot_size() == 32);
+
+  xcdr2::ShmWriter writer{ segment.acquire() };
+  writer << double{ 2.5 };
+  REQUIRE(segment.publish(writer.release()));
+  xcdr2::ShmReader reader{ other.take() };
+  double value{};
+  reader >> value;
+  REQUIRE(value == 2.5);
+}
+#endif
+
+#ifdef MFD_CLOEXEC
+TEST_CASE("xcdr2::ShmSegment refuses a buffer of another segment")
+{
+  xcdr2::ShmSegment segment = xcdr2::ShmSegment::create_anonymous(1, 32);
+  xcdr2::ShmSegment other = xcdr2::ShmSegment::create_anonymous(2, 32);
+  REQUIRE(segment.valid());
+  REQUIRE(other.valid());
+
+  xcdr2::ShmWriter writer{ segment.acquire() };
+  writer << uint32_t{ 1 };
+  REQUIRE_FALSE(other.publish(writer.release()));
+  REQUIRE_FALSE(other.take().valid());
+  REQUIRE_FALSE(segment.take().valid());
+  REQUIRE(segment.acquire().valid());
+}
+#endif
+
+TEST_CASE("xcdr2::ShmSegment that does not exist")
+{
+  REQUIRE_FALSE(xcdr2::ShmSegment::open(segment_name("missing")).valid());
+}
+
+#endif
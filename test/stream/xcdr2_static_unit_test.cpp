@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <once/cpputils/stream/xcdr2_static.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace once::cpputils;
+
+namespace {
+
+template<Endian E>
+constexpr xcdr2::StaticStream<E, 64>
+header()
+{
+  xcdr2::StaticStream<E, 64> stream{};
+  stream << uint8_t{ 1 } << double{ -0.5 } << std::string_view{ "topic" }
+         << int16_t{ -2 } << std::array<float, 2>{ 1.25f, 3.0f } << true;
+  return stream;
+}
+
+constexpr auto little_header = header<Endian::little>();
+static_assert(!little_header.overflowed());
+static_assert(33 == little_header.size());
+static_assert(0x01 == little_header.buffer()[0]);
+static_assert(0xbf == little_header.buffer()[11]);
+
+} // namespace
+
+TEMPLATE_TEST_CASE_SIG("xcdr2::StaticStream",
+                       "",
+                       ((Endian E), E),
+                       (Endian::little),
+                       (Endian::big))
+{
+  constexpr auto baked = header<E>();
+
+  SECTION("encodes like a stream")
+  {
+    xcdr2::Stream<E, std::vector<uint8_t>> stream{};
+    stream << uint8_t{ 1 } << double{ -0.5 } << std::string{ "topic" }
+           << int16_t{ -2 } << std::array<float, 2>{ 1.25f, 3.0f } << true;
+    REQUIRE(std::vector<uint8_t>(baked.data(), baked.data() + baked.size()) ==
+            stream.buffer());
+  }
+
+  SECTION("is copied aligned into a stream")
+  {
+    xcdr2::Stream<E, std::vector<uint8_t>> stream{};
+    stream << uint32_t{ 9 } << baked << uint32_t{ 42 };
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::ok);
+    REQUIRE(stream.buffer().size() == 4 + baked.size() + 3 + 4);
+
+    uint32_t first{};
+    uint8_t version{};
+    double value{};
+    std::string topic;
+    int16_t delta{};
+    std::array<float, 2> factors{};
+    bool enabled{};
+    uint32_t last{};
+    stream >> first >> version >> value;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(first == 9);
+    REQUIRE(version == 1);
+    REQUIRE(value == -0.5);
+    stream >> topic >> delta >> factors >> enabled >> last;
+    REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+    REQUIRE(topic == "topic");
+    REQUIRE(delta == -2);
+    REQUIRE(factors == std::array<float, 2>{ 1.25f, 3.0f });
+    REQUIRE(enabled);
+    REQUIRE(last == 42);
+  }
+
+  SECTION("is rejected at a misaligned position")
+  {
+    xcdr2::Stream<E, std::vector<uint8_t>> stream{};
+    stream << uint8_t{ 9 } << baked;
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::error);
+    REQUIRE(stream.buffer().size() == 1);
+  }
+
+  SECTION("flags an overflow")
+  {
+    constexpr auto overflowed = [] {
+      xcdr2::StaticStream<E, 6> stream{};
+      stream << uint8_t{ 1 } << uint32_t{ 2 };
+      return stream;
+    }();
+    STATIC_REQUIRE(overflowed.overflowed());
+    STATIC_REQUIRE(6 == overflowed.size());
+
+    xcdr2::Stream<E, std::vector<uint8_t>> stream{};
+    stream << overflowed;
+    REQUIRE(stream.ser_state() == xcdr2::StreamState::error);
+    REQUIRE(stream.buffer().empty());
+  }
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2021-present Julián Bermúdez Ortega
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Counts allocations through replaced global allocation functions, which
+// would affect any other test linked along.
+#define CATCH_CONFIG_MAIN
+
+#include <once/cpputils/stream/xcdr2.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <new>
+
+using namespace once::cpputils;
+
+namespace {
+
+thread_local bool counting = false;
+thread_local size_t allocations = 0;
+
+} // namespace
+
+// Every allocation function is replaced, so that whatever form allocates,
+// the memory is released by the matching one.
+namespace {
+
+void*
+allocate(size_t size) noexcept
+{
+  if (counting) {
+    ++allocations;
+  }
+  return std::malloc(size ? size : 1);
+}
+
+// Not inlined, so that GCC does not see free() called on the result of
+// operator new and warn about a mismatch.
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void
+deallocate(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+} // namespace
+
+void*
+operator new(size_t size)
+{
+  if (void* ptr = allocate(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void*
+operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void*
+operator new(size_t size, std::nothrow_t const&) noexcept
+{
+  return allocate(size);
+}
+
+void*
+operator new[](size_t size, std::nothrow_t const&) noexcept
+{
+  return allocate(size);
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  deallocate(ptr);
+}
+
+void
+operator delete[](void* ptr) noexcept
+{
+  deallocate(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept
+{
+  deallocate(ptr);
+}
+
+void
+operator delete[](void* ptr, size_t) noexcept
+{
+  deallocate(ptr);
+}
+
+void
+operator delete(void* ptr, std::nothrow_t const&) noexcept
+{
+  deallocate(ptr);
+}
+
+void
+operator delete[](void* ptr, std::nothrow_t const&) noexcept
+{
+  deallocate(ptr);
+}
+
+namespace {
+
+struct Message
+{
+  std::string name;
+  std::vector<std::string> tags;
+  std::vector<std::vector<double>> rows;
+  std::vector<bool> flags;
+  std::array<std::string, 2> labels;
+};
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator<<(xcdr2::Stream<E, B>& stream, Message const& message)
+{
+  return stream << message.name << message.tags << message.rows
+                << message.flags << message.labels;
+}
+
+template<Endian E, typename B>
+xcdr2::Stream<E, B>&
+operator>>(xcdr2::Stream<E, B>& stream, Message& message)
+{
+  return stream >> message.name >> message.tags >> message.rows >>
+         message.flags >> message.labels;
+}
+
+Message
+make_message(size_t size)
+{
+  Message message;
+  message.name = std::string(10 * size, 'n');
+  message.tags.assign(4, std::string(8 * size, 't'));
+  message.rows.assign(3, std::vector<double>(size, 0.5));
+  message.flags.assign(100 * size, true);
+  message.labels = { std::string(20 * size, 'a'), std::string(size, 'b') };
+  return message;
+}
+
+} // namespace
+
+TEST_CASE("xcdr2::Stream deserializes in steady state without allocating")
+{
+  xcdr2::VectorStream stream{};
+  Message large = make_message(8);
+  Message small = make_message(2);
+  for (size_t i = 0; i < 100; ++i) {
+    stream << ((i % 2) ? small : large);
+  }
+
+  Message message;
+  stream >> message;
+  REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+
+  counting = true;
+  for (size_t i = 1; i < 100; ++i) {
+    stream >> message;
+  }
+  counting = false;
+
+  REQUIRE(stream.deser_state() == xcdr2::StreamState::ok);
+  REQUIRE(stream.deser_length() == stream.ser_length());
+  REQUIRE(message.name == small.name);
+  REQUIRE(message.rows == small.rows);
+  REQUIRE(0 == allocations);
+}